@@ -1,12 +1,41 @@
 "use strict";
 
 function init(global, natives) {
-	global.cacheTexture = function(label, path) {
-		natives.cacheTexture(label, path);
+	// format is optional: rgba8, rgb8, rgb565, rgba4444, l8 or la8
+	global.cacheTexture = function(label, path, format) {
+		natives.cacheTexture(label, path, format);
+	}
+
+	// decodes [[label, path, format], ...] on every core and returns once all are uploaded; returns how many loaded
+	global.cacheTextures = function(textures) {
+		return natives.cacheTextures(textures);
+	}
+
+	var textureCallbacks = {};
+
+	// decodes on a worker; render() draws nothing for the label until callback(label, loaded) runs
+	global.cacheTextureAsync = function(label, path, callback, format) {
+		if (callback) {
+			textureCallbacks[label] = (textureCallbacks[label] || []).concat(callback);
+		}
+		natives.cacheTextureAsync(label, path, format);
+	}
+
+	global.textureLoaded = function(label, loaded) {
+		var callbacks = textureCallbacks[label] || [];
+		delete textureCallbacks[label];
+		for (var i = 0; i < callbacks.length; i++) {
+			callbacks[i](label, loaded);
+		}
 	}
 
 	global.cacheTexturesInit = function() {
-		global.cacheTexture('explosion', 'images/with_alpha/explosion.png');
+		if (natives.loadAtlas('atlas/sprites.idx')) {
+			return;
+		}
+		global.cacheTextures([
+			['explosion', 'images/with_alpha/explosion.png']
+		]);
 	}
 
 	global.cacheSoundsInit = function() {
@@ -39,7 +68,8 @@ function init(global, natives) {
 		}
 	}
 
-	global.render = function() {
+	// timestamp and delta are in ms, whole vsyncs; natives.setFrameRate(60, 30 or 0 for adaptive) picks the pace
+	global.render = function(timestamp, delta) {
 		if (!global.cameraSet) {
 			var data = natives.getScreenDimensions();
 			console.log(JSON.stringify(data));
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <android/asset_manager.h>
+
+#include "stb_image.h"
+
+#include <engine/asset_stream.h>
+
+#include <android/log.h>
+
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, "asset_stream", __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, "asset_stream", __VA_ARGS__))
+
+/**
+ * Decodes images straight out of the APK instead of reading the whole file
+ * onto the heap first. An asset stored uncompressed (aapt leaves .png and
+ * .jpg alone) is mapped by AAsset_getBuffer and decoded in place; a
+ * deflated one is fed to stb_image through its read callbacks, so the only
+ * allocation is the decoded image itself.
+ *
+ * Images always decode to four channels, the channel count of the file is
+ * reported separately. mapAsset() hands out files that need no decoding
+ * at all, such as texture containers, for as long as the asset stays open.
+ * Safe to call from any thread.
+ */
+namespace asset_stream {
+
+	static int readAsset(void* user, char* data, int size) {
+		int read = AAsset_read((AAsset*) user, data, size);
+		return read > 0 ? read : 0;
+	}
+
+	static void skipAsset(void* user, int count) {
+		AAsset_seek((AAsset*) user, count, SEEK_CUR);
+	}
+
+	static int endOfAsset(void* user) {
+		return AAsset_getRemainingLength((AAsset*) user) <= 0;
+	}
+
+	static bool isStored(AAsset* asset) {
+		// only assets stored without compression can be handed out as a file descriptor
+		off_t start, length;
+		int descriptor = AAsset_openFileDescriptor(asset, &start, &length);
+		if (descriptor < 0) {
+			return false;
+		}
+		close(descriptor);
+		return true;
+	}
+
+	unsigned char* loadImage(void* assetManager, const char* path, int* width, int* height, int* channels) {
+		AAsset* asset = AAssetManager_open((AAssetManager*) assetManager, path, AASSET_MODE_STREAMING);
+		if (asset == NULL) {
+			LOGE("No asset %s", path);
+			return NULL;
+		}
+
+		unsigned char* image = NULL;
+		const void* buffer = isStored(asset) ? AAsset_getBuffer(asset) : NULL;
+		if (buffer != NULL) {
+			image = stbi_load_from_memory((const stbi_uc*) buffer, (int) AAsset_getLength(asset), width, height, channels, 4);
+		}
+		else {
+			stbi_io_callbacks callbacks = {readAsset, skipAsset, endOfAsset};
+			image = stbi_load_from_callbacks(&callbacks, asset, width, height, channels, 4);
+		}
+
+		AAsset_close(asset);
+		return image;
+	}
+
+	void* mapAsset(void* assetManager, const char* path, const unsigned char* magic, int magicSize, const unsigned char** data, int* size) {
+		AAsset* asset = AAssetManager_open((AAssetManager*) assetManager, path, AASSET_MODE_STREAMING);
+		if (asset == NULL) {
+			return NULL;
+		}
+
+		// a cheap read first, so an asset of another kind is never inflated whole
+		unsigned char header[16];
+		bool matches = magicSize <= (int) sizeof(header) && AAsset_read(asset, header, magicSize) == magicSize && memcmp(header, magic, magicSize) == 0;
+		AAsset_close(asset);
+		if (!matches) {
+			return NULL;
+		}
+
+		asset = AAssetManager_open((AAssetManager*) assetManager, path, AASSET_MODE_BUFFER);
+		if (asset == NULL) {
+			return NULL;
+		}
+		if (!isStored(asset)) {
+			LOGI("%s is compressed in the APK, it is inflated onto the heap instead of mapped", path);
+		}
+
+		*data = (const unsigned char*) AAsset_getBuffer(asset);
+		*size = (int) AAsset_getLength(asset);
+		if (*data == NULL) {
+			AAsset_close(asset);
+			return NULL;
+		}
+		return asset;
+	}
+
+	void closeAsset(void* asset) {
+		if (asset != NULL) {
+			AAsset_close((AAsset*) asset);
+		}
+	}
+
+}
\ No newline at end of file
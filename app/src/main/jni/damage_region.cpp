@@ -0,0 +1,334 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <engine/damage_region.h>
+#include <engine/sprite_batch.h>
+
+#include <android/log.h>
+
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, "damage_region", __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, "damage_region", __VA_ARGS__))
+
+#ifndef EGL_BUFFER_AGE_EXT
+#define EGL_BUFFER_AGE_EXT 0x313D
+#endif
+
+/**
+ * Works out which part of the window changed since the last drawn frame.
+ * Every sprite is reduced to a hash of everything that affects its pixels
+ * (sprite data, sort key, matrices) plus its bounding rectangle in window
+ * coordinates; sprites present in only one of the two frames damage their
+ * rectangle. The clear colour is tracked like a sprite covering the window.
+ *
+ * With EGL_EXT_buffer_age the back buffer still holds a frame from a few
+ * swaps ago, so only the damage of those frames is redrawn, behind one
+ * scissor rectangle. EGL_KHR/EXT_swap_buffers_with_damage hands this frame's
+ * rectangles to the compositor. Anything unknown (no extension, age 0, a
+ * resized surface, a sprite crossing the near plane) redraws everything.
+ */
+namespace damage_region {
+
+	typedef EGLBoolean (*swap_with_damage_function)(EGLDisplay, EGLSurface, EGLint*, EGLint);
+
+	static const int MAX_RECTS = 4;
+	static const int HISTORY = 4;
+
+	struct rect_struct {
+		int left, bottom, right, top;
+	};
+
+	struct entry_struct {
+		uint64_t hash;
+		rect_struct rect;
+
+		bool operator<(const entry_struct& other) const {
+			return hash < other.hash;
+		}
+	};
+
+	static bool bufferAge = false;
+	static swap_with_damage_function swapWithDamage = NULL;
+
+	static int surfaceWidth = 0, surfaceHeight = 0;
+	static int viewportWidth = 0, viewportHeight = 0;
+	static EGLint age = 0;
+
+	static float mvp[16];
+	static uint64_t matrixHash = 0;
+
+	static std::vector<entry_struct> previous;
+	static std::vector<entry_struct> current;
+
+	// this frame's damage, and the bounding box of the frames before it, newest first
+	static rect_struct rects[MAX_RECTS];
+	static int rectCount = 0;
+	static bool fullDamage = true;
+	static rect_struct history[HISTORY];
+	static int historyCount = 0;
+
+	static int lastRedrawnPixels = 0;
+
+	static uint64_t hashWords(uint64_t value, const void* data, size_t size) {
+		const uint32_t* words = (const uint32_t*) data;
+		for (size_t i = 0; i < size / 4; i++) {
+			value ^= words[i];
+			value *= 1099511628211ull;
+		}
+		return value;
+	}
+
+	static bool hasExtension(const char* extensions, const char* name) {
+		size_t length = strlen(name);
+		for (const char* found = strstr(extensions, name); found != NULL; found = strstr(found + length, name)) {
+			if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0')) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void init(EGLDisplay display) {
+		const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+		if (extensions == NULL) {
+			extensions = "";
+		}
+
+		bufferAge = hasExtension(extensions, "EGL_EXT_buffer_age");
+		swapWithDamage = NULL;
+		if (hasExtension(extensions, "EGL_KHR_swap_buffers_with_damage")) {
+			swapWithDamage = (swap_with_damage_function) eglGetProcAddress("eglSwapBuffersWithDamageKHR");
+		}
+		if (swapWithDamage == NULL && hasExtension(extensions, "EGL_EXT_swap_buffers_with_damage")) {
+			swapWithDamage = (swap_with_damage_function) eglGetProcAddress("eglSwapBuffersWithDamageEXT");
+		}
+
+		previous.clear();
+		historyCount = 0;
+		LOGI("Buffer age %s, swap with damage %s", bufferAge ? "yes" : "no", swapWithDamage != NULL ? "yes" : "no");
+	}
+
+	bool isTracking() {
+		return bufferAge || swapWithDamage != NULL;
+	}
+
+	void beginFrame(EGLDisplay display, EGLSurface surface, int width, int height) {
+		EGLint queriedWidth = 0, queriedHeight = 0;
+		eglQuerySurface(display, surface, EGL_WIDTH, &queriedWidth);
+		eglQuerySurface(display, surface, EGL_HEIGHT, &queriedHeight);
+
+		// nothing carries over to a surface of another size
+		if (queriedWidth != surfaceWidth || queriedHeight != surfaceHeight || width != viewportWidth || height != viewportHeight) {
+			previous.clear();
+			historyCount = 0;
+		}
+		surfaceWidth = queriedWidth;
+		surfaceHeight = queriedHeight;
+		viewportWidth = width;
+		viewportHeight = height;
+
+		age = 0;
+		if (bufferAge && eglQuerySurface(display, surface, EGL_BUFFER_AGE_EXT, &age) == EGL_FALSE) {
+			age = 0;
+		}
+
+		current.clear();
+		rectCount = 0;
+		fullDamage = previous.empty();
+		lastRedrawnPixels = surfaceWidth * surfaceHeight;
+	}
+
+	void setMatrices(const float* projection, const float* view) {
+		for (int column = 0; column < 4; column++) {
+			for (int row = 0; row < 4; row++) {
+				float sum = 0.0f;
+				for (int k = 0; k < 4; k++) {
+					sum += projection[k*4 + row] * view[column*4 + k];
+				}
+				mvp[column*4 + row] = sum;
+			}
+		}
+		matrixHash = hashWords(14695981039346656037ull, mvp, sizeof(mvp));
+	}
+
+	static rect_struct fullRect() {
+		rect_struct rect = {0, 0, surfaceWidth, surfaceHeight};
+		return rect;
+	}
+
+	static void addEntry(uint64_t hash, const rect_struct& rect) {
+		if (rect.right <= rect.left || rect.top <= rect.bottom) {
+			return;
+		}
+
+		entry_struct entry;
+		entry.hash = hash;
+		entry.rect = rect;
+		current.push_back(entry);
+	}
+
+	void addClear(const float* color) {
+		uint64_t hash = color != NULL ? hashWords(1, color, 3 * sizeof(float)) : 0;
+		addEntry(hash, fullRect());
+	}
+
+	void add(const sprite_struct& sprite, uint64_t key) {
+		uint64_t hash = hashWords(matrixHash, &sprite, sizeof(sprite));
+		hash = hashWords(hash, &key, sizeof(key));
+
+		float cosine = 1.0f, sine = 0.0f;
+		if (sprite.rotation != 0.0f) {
+			cosine = cosf(sprite.rotation);
+			sine = sinf(sprite.rotation);
+		}
+
+		// same corners as sprite_batch, taken through the camera into window pixels
+		float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+		const float* quad = sprite.quadRect;
+		for (int i = 0; i < 4; i++) {
+			float localX = ((i & 1) ? quad[2] : quad[0]) * sprite.scale;
+			float localY = ((i & 2) ? quad[3] : quad[1]) * sprite.scale;
+			float x = sprite.x + localX * cosine - localY * sine;
+			float y = sprite.y + localX * sine + localY * cosine;
+
+			float clipX = mvp[0]*x + mvp[4]*y + mvp[8]*sprite.z + mvp[12];
+			float clipY = mvp[1]*x + mvp[5]*y + mvp[9]*sprite.z + mvp[13];
+			float clipW = mvp[3]*x + mvp[7]*y + mvp[11]*sprite.z + mvp[15];
+			if (clipW <= 1e-6f) {
+				addEntry(hash, fullRect());
+				return;
+			}
+
+			float windowX = (clipX / clipW * 0.5f + 0.5f) * viewportWidth;
+			float windowY = (clipY / clipW * 0.5f + 0.5f) * viewportHeight;
+			minX = windowX < minX ? windowX : minX;
+			minY = windowY < minY ? windowY : minY;
+			maxX = windowX > maxX ? windowX : maxX;
+			maxY = windowY > maxY ? windowY : maxY;
+		}
+
+		// a pixel of margin for filtering and rounding
+		rect_struct rect;
+		rect.left = (int) floorf(std::max(minX - 1.0f, 0.0f));
+		rect.bottom = (int) floorf(std::max(minY - 1.0f, 0.0f));
+		rect.right = (int) ceilf(std::min(maxX + 1.0f, (float) surfaceWidth));
+		rect.top = (int) ceilf(std::min(maxY + 1.0f, (float) surfaceHeight));
+		addEntry(hash, rect);
+	}
+
+	static rect_struct unite(const rect_struct& a, const rect_struct& b) {
+		rect_struct rect = {std::min(a.left, b.left), std::min(a.bottom, b.bottom), std::max(a.right, b.right), std::max(a.top, b.top)};
+		return rect;
+	}
+
+	static long area(const rect_struct& rect) {
+		return (long) (rect.right - rect.left) * (rect.top - rect.bottom);
+	}
+
+	static void addDamage(rect_struct rect) {
+		// touching rectangles are merged, past MAX_RECTS the one that grows least takes it
+		for (int i = 0; i < rectCount; i++) {
+			const rect_struct& other = rects[i];
+			if (rect.left <= other.right && other.left <= rect.right && rect.bottom <= other.top && other.bottom <= rect.top) {
+				rect = unite(rect, other);
+				rects[i] = rects[--rectCount];
+				i = -1;
+			}
+		}
+
+		if (rectCount < MAX_RECTS) {
+			rects[rectCount++] = rect;
+			return;
+		}
+
+		int best = 0;
+		long bestGrowth = -1;
+		for (int i = 0; i < rectCount; i++) {
+			long growth = area(unite(rects[i], rect)) - area(rects[i]);
+			if (bestGrowth < 0 || growth < bestGrowth) {
+				best = i;
+				bestGrowth = growth;
+			}
+		}
+		rects[best] = unite(rects[best], rect);
+	}
+
+	/* Diffs against the last frame and returns whether only the scissor rectangle {x, y, width, height} needs drawing. */
+	bool resolve(int* scissor) {
+		std::sort(current.begin(), current.end());
+
+		if (!fullDamage) {
+			size_t i = 0, j = 0;
+			while (i < current.size() || j < previous.size()) {
+				if (j == previous.size() || (i < current.size() && current[i].hash < previous[j].hash)) {
+					addDamage(current[i++].rect);
+				}
+				else if (i == current.size() || previous[j].hash < current[i].hash) {
+					addDamage(previous[j++].rect);
+				}
+				else {
+					i++;
+					j++;
+				}
+			}
+		}
+
+		rect_struct frameBox = {0, 0, 0, 0};
+		if (fullDamage) {
+			frameBox = fullRect();
+			rectCount = 0;
+		}
+		for (int i = 0; i < rectCount; i++) {
+			frameBox = i == 0 ? rects[i] : unite(frameBox, rects[i]);
+		}
+
+		// the back buffer is age frames old, so their damage is redrawn along with this frame's
+		bool partial = bufferAge && !fullDamage && age > 0 && age - 1 <= historyCount;
+		rect_struct region = frameBox;
+		for (int i = 0; partial && i < age - 1; i++) {
+			region = area(region) == 0 ? history[i] : (area(history[i]) == 0 ? region : unite(region, history[i]));
+		}
+		if (!partial) {
+			region = fullRect();
+		}
+
+		for (int i = HISTORY - 1; i > 0; i--) {
+			history[i] = history[i - 1];
+		}
+		history[0] = frameBox;
+		historyCount = std::min(historyCount + 1, HISTORY);
+
+		previous.swap(current);
+
+		scissor[0] = region.left;
+		scissor[1] = region.bottom;
+		scissor[2] = region.right - region.left;
+		scissor[3] = region.top - region.bottom;
+		lastRedrawnPixels = (int) area(region);
+		return partial;
+	}
+
+	EGLBoolean swap(EGLDisplay display, EGLSurface surface) {
+		if (swapWithDamage == NULL || fullDamage || rectCount == 0) {
+			return eglSwapBuffers(display, surface);
+		}
+
+		EGLint damage[MAX_RECTS * 4];
+		for (int i = 0; i < rectCount; i++) {
+			damage[i*4] = rects[i].left;
+			damage[i*4 + 1] = rects[i].bottom;
+			damage[i*4 + 2] = rects[i].right - rects[i].left;
+			damage[i*4 + 3] = rects[i].top - rects[i].bottom;
+		}
+		return swapWithDamage(display, surface, damage, rectCount);
+	}
+
+	void getStats(int* redrawnPixels) {
+		*redrawnPixels = lastRedrawnPixels;
+	}
+
+}
\ No newline at end of file
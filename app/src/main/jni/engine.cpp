@@ -4,12 +4,15 @@
 #define LOGE(...) ((void)__android_log_print(ANDROID_LOG_INFO, "chickpea", __VA_ARGS__))
 
 #include <stdio.h>
+#include <string.h>
 
 #include <integration_contract.h>
 #include <integration_enums.h>
 
 #include <engine/opengl_wrapper.h>
 
+#include <engine/frame_scheduler.h>
+
 #include <engine/jx_wrapper.h>
 
 #include <engine/opensles_wrapper.h>
@@ -31,6 +34,16 @@ struct engine_struct {
 
 	int animating;
 
+	// a rotation failed to rebuild the surface, the next one that succeeds starts animating again
+	bool resizeFailed;
+
+	// the last frame matched the one on screen, so the loop may wait for events
+	bool idle;
+
+	// paced by frame_scheduler, handed to global.render()
+	double frameTimestamp;
+	double frameDelta;
+
 	saved_state state;
 };
 
@@ -70,7 +83,8 @@ namespace chickpea {
 	}
 
 	static void terminate_display(engine_struct* engine) {
-		opengl_wrapper::destroy();
+		// keeps the context, so textures and programs survive until the next window
+		opengl_wrapper::releaseWindow();
 		engine->animating = 0;
 	}
 
@@ -180,14 +194,65 @@ namespace chickpea {
 	}
 
 
+	/* Copies a value into a single quoted JS string literal body, escaping anything that could end it or run as code. */
+	static void escapeScriptString(const char* value, char* out, size_t size) {
+		size_t length = 0;
+		for (const unsigned char* c = (const unsigned char*) value; *c != 0; c++) {
+			char escaped[8];
+			if (*c == '\\' || *c == '\'') {
+				snprintf(escaped, sizeof(escaped), "\\%c", *c);
+			}
+			else if (*c < 0x20 || *c == 0x7F) {
+				snprintf(escaped, sizeof(escaped), "\\x%02x", *c);
+			}
+			else if (*c == 0xE2 && c[1] == 0x80 && (c[2] == 0xA8 || c[2] == 0xA9)) {
+				// U+2028 and U+2029 end a line inside a literal too
+				snprintf(escaped, sizeof(escaped), "\\u%04x", c[2] == 0xA8 ? 0x2028 : 0x2029);
+				c += 2;
+			}
+			else {
+				escaped[0] = (char) *c;
+				escaped[1] = 0;
+			}
+
+			size_t escapedLength = strlen(escaped);
+			if (length + escapedLength >= size) {
+				break;
+			}
+			memcpy(out + length, escaped, escapedLength);
+			length += escapedLength;
+		}
+		out[length] = 0;
+	}
+
 	void engine_draw_frame(global_struct* global) {
 		engine_struct* engine = (engine_struct*) global->appdata.internal;
 
 		if (!engine->animating) {return;}
 
-		jx_wrapper::evaluate((char*)"global.render();");
+		// textures decoded in the background are uploaded within a budget and reported before the frame
+		opengl_wrapper::uploadDecodedTextures();
+		char label[256];
+		bool loaded;
+		while (opengl_wrapper::takeFinishedTexture(label, sizeof(label), &loaded)) {
+			// labels come from scripts and file names, so they are data, never source
+			char escapedLabel[sizeof(label) * 6];
+			escapeScriptString(label, escapedLabel, sizeof(escapedLabel));
+			char script[sizeof(escapedLabel) + 64];
+			snprintf(script, sizeof(script), "global.textureLoaded('%s', %s);", escapedLabel, loaded ? "true" : "false");
+			jx_wrapper::evaluate(script);
+		}
+
+		char render[96];
+		snprintf(render, sizeof(render), "global.render(%.3f, %.3f);", engine->frameTimestamp, engine->frameDelta);
+		jx_wrapper::evaluate(render);
+		frame_scheduler::endFrame();
 
-		opengl_wrapper::swapBuffers();
+		// hands the recorded frame to the render thread, which draws and swaps it unless nothing changed
+		engine->idle = !opengl_wrapper::swapBuffers();
+		if (engine->idle) {
+			frame_scheduler::idleFrame();
+		}
 	}
 
 	/**
@@ -205,19 +270,34 @@ namespace chickpea {
 			case APP_CMD_INIT_WINDOW:
 				// The window is being shown, get it ready.
 				if (app->native_stuff.window != NULL) {
-					init_display(engine);
+					if (init_display(engine) != 0) {
+						// no surface to draw into, the next INIT_WINDOW tries again
+						LOGE("Could not initialize the display");
+						terminate_display(engine);
+						break;
+					}
 
 					opengl_wrapper::initProgram();
 
 					jx_wrapper::setRenderCallback(opengl_wrapper::render);
+					jx_wrapper::setSetLayerCallback(opengl_wrapper::setLayer);
+					jx_wrapper::setSetLayerSortedCallback(opengl_wrapper::setLayerSorted);
+					jx_wrapper::setSetBlendModeCallback(opengl_wrapper::setBlendMode);
 					jx_wrapper::setSetCameraCallback(opengl_wrapper::setCamera);
 					jx_wrapper::setGetScreenDimensionsCallback(opengl_wrapper::getScreenDimensions);
 					jx_wrapper::setUnprojectCallback(opengl_wrapper::unprojectOnZeroLevel);
+					jx_wrapper::setGetRenderStatsCallback(opengl_wrapper::getRenderStats);
 					jx_wrapper::setClearScreenCallback(opengl_wrapper::clearScreen);
 					jx_wrapper::setCacheTextureCallback(opengl_wrapper::cacheTexture);
+					jx_wrapper::setCacheTextureAsyncCallback(opengl_wrapper::cacheTextureAsync);
+					jx_wrapper::setCacheTexturesCallback(opengl_wrapper::cacheTextures);
+					jx_wrapper::setLoadAtlasCallback(opengl_wrapper::loadAtlas);
+					jx_wrapper::setSetTextureBudgetCallback(opengl_wrapper::setTextureBudget);
+					jx_wrapper::setSetFrameRateCallback(frame_scheduler::setFrameRate);
 					jx_wrapper::evaluate((char*)"global.cacheTexturesInit();");
 
 					engine->animating = 1;
+					engine->resizeFailed = false;
 
 					opensles_wrapper::setPlayingAssetAudioPlayer(true);
 				}
@@ -239,22 +319,25 @@ namespace chickpea {
 				// opensles_wrapper::setPlayingAssetAudioPlayer2(true);
 				break;
 			case APP_CMD_CONFIG_CHANGED:
-				engine->animating = 0;
-				terminate_display(engine);
-				init_display(engine);
-
-				opengl_wrapper::initProgram();
-
-				jx_wrapper::setRenderCallback(opengl_wrapper::render);
-				jx_wrapper::setSetCameraCallback(opengl_wrapper::setCamera);
-				jx_wrapper::setGetScreenDimensionsCallback(opengl_wrapper::getScreenDimensions);
-				jx_wrapper::setUnprojectCallback(opengl_wrapper::unprojectOnZeroLevel);
-				jx_wrapper::setClearScreenCallback(opengl_wrapper::clearScreen);
-				jx_wrapper::setCacheTextureCallback(opengl_wrapper::cacheTexture);
-				jx_wrapper::evaluate((char*)"global.cacheTexturesInit();");
-
-				engine->animating = 1;
-
+				// only the surface and viewport follow a rotation, the context and everything in it stay
+				if (app->native_stuff.window != NULL) {
+					int resized = opengl_wrapper::resize(app);
+					if (resized < 0) {
+						// same as a failed INIT_WINDOW, resize goes through init again next time
+						LOGE("Could not resize the display");
+						terminate_display(engine);
+						engine->resizeFailed = true;
+						break;
+					}
+					if (resized > 0) {
+						opengl_wrapper::initProgram();
+						jx_wrapper::evaluate((char*)"global.cacheTexturesInit();");
+					}
+					if (engine->resizeFailed) {
+						engine->resizeFailed = false;
+						engine->animating = 1;
+					}
+				}
 				break;
 			case APP_CMD_LOST_FOCUS:
 				engine->animating = 0;
@@ -285,10 +368,10 @@ namespace chickpea {
 		engine_value->app = global;
 	}
 
-	int getInputIdentifier() {
+	int getInputIdentifier(int timeout) {
 		int uselessEvents;
 
-		return ALooper_pollAll(0, NULL, &uselessEvents, NULL);
+		return ALooper_pollAll(timeout, NULL, &uselessEvents, NULL);
 	}
 
 	bool shouldExit(global_struct* global) {
@@ -296,9 +379,22 @@ namespace chickpea {
 	}
 
 	void processInput(global_struct* global) {
+		engine_struct* engine = (engine_struct*) global->appdata.internal;
 		int identifier;
 
-		while ((identifier = getInputIdentifier()) >= 0) {
+		// a static screen blocks in the looper until something arrives
+		bool waiting = engine->idle && engine->animating && opengl_wrapper::isIdle();
+		int timeout = waiting ? -1 : 0;
+		engine->idle = false;
+
+		// sleeps until the next frame is due, so the input read below is as fresh as it gets
+		if (!waiting) {
+			frame_scheduler::beginFrame(&engine->frameTimestamp, &engine->frameDelta);
+		}
+
+		while ((identifier = getInputIdentifier(timeout)) >= 0) {
+			timeout = 0;
+			opengl_wrapper::markDirty();
 
 			if (identifier == LOOPER_ID_MAIN) {
 				global->native_stuff.process_cmd(global, engine_handle_cmd);
@@ -309,6 +405,10 @@ namespace chickpea {
 			}
 		}
 
+		if (waiting) {
+			frame_scheduler::beginFrame(&engine->frameTimestamp, &engine->frameDelta);
+		}
+
 		jx_wrapper::evaluate((char*)"global.processInput();");
 	}
 
@@ -320,6 +420,8 @@ namespace chickpea {
 
 	void destroy(global_struct* global) {
 		terminate_display((engine_struct*) global->appdata.internal);
+		opengl_wrapper::destroy();
+		opengl_wrapper::shutdown();
 		jx_wrapper::destroy();
 		opensles_wrapper::shutdown();
 		free((engine_struct*) global->appdata.internal);
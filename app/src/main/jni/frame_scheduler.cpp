@@ -0,0 +1,219 @@
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <engine/frame_scheduler.h>
+
+/**
+ * Paces the logic thread to the display instead of letting it spin. Frames
+ * start on a fixed cadence (one or two vsyncs, matching the eglSwapInterval
+ * the render thread applies), and the cadence is slowly pulled into phase
+ * with the times the render thread reports its swaps finishing, so a frame
+ * is recorded right after the previous one went out.
+ *
+ * JS gets a delta quantized to whole vsyncs and a timestamp that is the sum
+ * of those deltas, so it is monotonic and never jitters; long stalls (a
+ * paused app, a debugger) are clamped rather than replayed.
+ *
+ * The clock and the sleep are plain function pointers so the whole thing
+ * runs against a simulated clock off device.
+ */
+namespace frame_scheduler {
+
+	static const double VSYNC_MILLIS = 1000.0 / 60.0;
+	// how long after a swap returns the next logic frame should start
+	static const double LEAD_MILLIS = 1.0;
+	static const double PHASE_GAIN = 0.1;
+	static const int MAX_DELTA_VSYNCS = 6;
+	// adaptive mode drops to 30 fps after this many slow frames, and back after as many fast ones
+	static const int ADAPT_FRAMES = 30;
+
+	static double systemNow() {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+	}
+
+	static void systemSleep(double millis) {
+		struct timespec duration;
+		duration.tv_sec = (time_t) (millis / 1000.0);
+		duration.tv_nsec = (long) ((millis - duration.tv_sec * 1000.0) * 1000000.0);
+		nanosleep(&duration, NULL);
+	}
+
+	static double (*now)() = systemNow;
+	static void (*sleepFor)(double) = systemSleep;
+
+	// guards what the render thread reads or reports
+	static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	static int frameRate = 60;
+	static int swapInterval = 1;
+	static double lastPresent = 0;
+	static double presentAverage = 0;
+	static double renderAverage = 0;
+
+	static double origin = 0;
+	static double timestamp = 0;
+	static double delta = 0;
+	static double nextStart = 0;
+	static double lastReturn = 0;
+	static double busy = 0;
+	static double busyAverage = 0;
+	static int slowFrames = 0, fastFrames = 0;
+	static int missedFrames = 0;
+
+	static void reset() {
+		origin = 0;
+		timestamp = 0;
+		delta = 0;
+		nextStart = 0;
+		lastReturn = 0;
+		busy = 0;
+		busyAverage = 0;
+		slowFrames = 0;
+		fastFrames = 0;
+		missedFrames = 0;
+		lastPresent = 0;
+		presentAverage = 0;
+		renderAverage = 0;
+	}
+
+	void setClock(double (*nowFunction)(), void (*sleepFunction)(double)) {
+		now = nowFunction != NULL ? nowFunction : systemNow;
+		sleepFor = sleepFunction != NULL ? sleepFunction : systemSleep;
+
+		pthread_mutex_lock(&mutex);
+		reset();
+		pthread_mutex_unlock(&mutex);
+	}
+
+	void setFrameRate(int rate) {
+		pthread_mutex_lock(&mutex);
+		frameRate = rate;
+		swapInterval = rate == 30 ? 2 : 1;
+		slowFrames = 0;
+		fastFrames = 0;
+		pthread_mutex_unlock(&mutex);
+	}
+
+	int getSwapInterval() {
+		pthread_mutex_lock(&mutex);
+		int interval = swapInterval;
+		pthread_mutex_unlock(&mutex);
+
+		return interval;
+	}
+
+	static void adapt(double busy, double present, double render) {
+		if (frameRate != FRAME_RATE_ADAPTIVE) {
+			return;
+		}
+
+		// misses show up as swaps further apart than a vsync; either thread can be the slow one
+		double work = busy > render ? busy : render;
+		if (swapInterval == 1) {
+			slowFrames = present > VSYNC_MILLIS * 1.25 || work > VSYNC_MILLIS * 0.9 ? slowFrames + 1 : 0;
+			if (slowFrames >= ADAPT_FRAMES) {
+				swapInterval = 2;
+				slowFrames = 0;
+			}
+		}
+		else {
+			fastFrames = work < VSYNC_MILLIS * 0.6 ? fastFrames + 1 : 0;
+			if (fastFrames >= ADAPT_FRAMES) {
+				swapInterval = 1;
+				fastFrames = 0;
+			}
+		}
+	}
+
+	void beginFrame(double* frameTimestamp, double* frameDelta) {
+		double start = now();
+
+		pthread_mutex_lock(&mutex);
+		if (busy > 0) {
+			busyAverage += (busy - busyAverage) * 0.1;
+			adapt(busyAverage, presentAverage, renderAverage);
+			busy = 0;
+		}
+		double period = VSYNC_MILLIS * swapInterval;
+		double present = lastPresent;
+		pthread_mutex_unlock(&mutex);
+
+		if (nextStart == 0 || start - nextStart > period) {
+			// first frame, or the cadence fell more than a frame behind: restart it here
+			if (nextStart != 0) {
+				missedFrames++;
+			}
+			nextStart = start;
+		}
+		else if (present > 0) {
+			double error = fmod(nextStart - present - LEAD_MILLIS, period);
+			if (error > period / 2) {
+				error -= period;
+			}
+			else if (error < -period / 2) {
+				error += period;
+			}
+			nextStart -= error * PHASE_GAIN;
+		}
+
+		if (nextStart > start) {
+			sleepFor(nextStart - start);
+		}
+		nextStart += period;
+
+		double current = now();
+		if (origin == 0) {
+			origin = current - period;
+		}
+
+		// the elapsed time is measured against the summed deltas, so rounding never drifts
+		int vsyncs = (int) floor((current - origin - timestamp) / VSYNC_MILLIS + 0.5);
+		if (vsyncs > MAX_DELTA_VSYNCS) {
+			origin += (vsyncs - MAX_DELTA_VSYNCS) * VSYNC_MILLIS;
+			vsyncs = MAX_DELTA_VSYNCS;
+		}
+		if (vsyncs < 1) {
+			vsyncs = 1;
+		}
+		delta = vsyncs * VSYNC_MILLIS;
+		timestamp += delta;
+
+		*frameTimestamp = timestamp;
+		*frameDelta = delta;
+		lastReturn = now();
+	}
+
+	void endFrame() {
+		// only the recording counts as work, not waiting for a free frame slot
+		busy = now() - lastReturn;
+	}
+
+	void idleFrame() {
+		// the loop is about to block on events, so the next frame restarts the cadence instead of counting a miss
+		nextStart = 0;
+		busy = 0;
+	}
+
+	void framePresented(double renderMillis) {
+		double current = now();
+
+		pthread_mutex_lock(&mutex);
+		if (lastPresent > 0) {
+			presentAverage += (current - lastPresent - presentAverage) * 0.1;
+		}
+		renderAverage += (renderMillis - renderAverage) * 0.1;
+		lastPresent = current;
+		pthread_mutex_unlock(&mutex);
+	}
+
+	void getStats(float* frameDelta, float* presentMillis, int* missed) {
+		pthread_mutex_lock(&mutex);
+		*frameDelta = (float) delta;
+		*presentMillis = (float) presentAverage;
+		*missed = missedFrames;
+		pthread_mutex_unlock(&mutex);
+	}
+
+}
\ No newline at end of file
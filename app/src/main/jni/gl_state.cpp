@@ -0,0 +1,270 @@
+#include <string.h>
+#include <map>
+#include <string>
+
+#include <GLES3/gl3.h>
+
+#include <engine/gl_state.h>
+
+/**
+ * Shadow copy of the GL state the wrappers touch. Every call compares against
+ * the shadow and only reaches the driver when the value actually changes.
+ * reset() must be called whenever a context is made current, since the shadow
+ * can't know what a fresh context contains.
+ */
+namespace gl_state {
+
+	static const int MAX_TEXTURE_UNITS = 8;
+	static const int MAX_ATTRIBS = 16;
+
+	static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	static GLuint program;
+	static GLuint textures[MAX_TEXTURE_UNITS];
+	static int activeUnit;
+	static GLuint arrayBuffer, elementBuffer;
+	static int attribs[MAX_ATTRIBS];
+	static GLuint divisors[MAX_ATTRIBS];
+	static int blendEnabled;
+	static GLenum blendSrc, blendDst;
+	static GLint viewportValue[4];
+	static int scissorEnabled;
+	static GLint scissorValue[4];
+
+	static std::map<GLuint, std::map<std::string, GLint> > uniformLocations;
+	static std::map<GLuint, std::map<std::string, GLint> > attribLocations;
+
+	struct matrix_value {
+		GLfloat data[16];
+	};
+
+	static std::map<GLuint, std::map<GLint, matrix_value> > uniformMatrices;
+
+	static int frameIssued = 0, frameElided = 0;
+	static int lastIssued = 0, lastElided = 0;
+
+	static inline bool changed(bool isDifferent) {
+		if (isDifferent) {
+			frameIssued++;
+		}
+		else {
+			frameElided++;
+		}
+		return isDifferent;
+	}
+
+	void reset() {
+		program = UNKNOWN;
+		for (int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+			textures[i] = UNKNOWN;
+		}
+		activeUnit = -1;
+		arrayBuffer = UNKNOWN;
+		elementBuffer = UNKNOWN;
+		for (int i = 0; i < MAX_ATTRIBS; i++) {
+			attribs[i] = -1;
+			divisors[i] = UNKNOWN;
+		}
+		blendEnabled = -1;
+		blendSrc = UNKNOWN;
+		blendDst = UNKNOWN;
+		viewportValue[0] = viewportValue[1] = viewportValue[2] = viewportValue[3] = -1;
+		scissorEnabled = -1;
+		scissorValue[0] = scissorValue[1] = scissorValue[2] = scissorValue[3] = -1;
+
+		uniformLocations.clear();
+		attribLocations.clear();
+		uniformMatrices.clear();
+	}
+
+	void useProgram(GLuint value) {
+		if (changed(program != value)) {
+			glUseProgram(value);
+			program = value;
+		}
+	}
+
+	void forgetProgram(GLuint value) {
+		uniformLocations.erase(value);
+		attribLocations.erase(value);
+		uniformMatrices.erase(value);
+		if (program == value) {
+			program = UNKNOWN;
+		}
+	}
+
+	GLint uniformLocation(GLuint programValue, const char* name) {
+		std::map<std::string, GLint>& locations = uniformLocations[programValue];
+		std::map<std::string, GLint>::iterator found = locations.find(name);
+		if (!changed(found == locations.end())) {
+			return found->second;
+		}
+
+		GLint location = glGetUniformLocation(programValue, name);
+		locations[name] = location;
+		return location;
+	}
+
+	GLint attribLocation(GLuint programValue, const char* name) {
+		std::map<std::string, GLint>& locations = attribLocations[programValue];
+		std::map<std::string, GLint>::iterator found = locations.find(name);
+		if (!changed(found == locations.end())) {
+			return found->second;
+		}
+
+		GLint location = glGetAttribLocation(programValue, name);
+		locations[name] = location;
+		return location;
+	}
+
+	void uniformMatrix4(GLint location, const GLfloat* value) {
+		if (location < 0) {
+			return;
+		}
+
+		std::map<GLint, matrix_value>& matrices = uniformMatrices[program];
+		std::map<GLint, matrix_value>::iterator found = matrices.find(location);
+		bool isDifferent = found == matrices.end() || memcmp(found->second.data, value, sizeof(found->second.data)) != 0;
+
+		if (changed(isDifferent)) {
+			glUniformMatrix4fv(location, 1, GL_FALSE, value);
+			memcpy(matrices[location].data, value, sizeof(GLfloat) * 16);
+		}
+	}
+
+	void bindTexture(int unit, GLuint texture) {
+		if (changed(textures[unit] != texture)) {
+			if (activeUnit != unit) {
+				glActiveTexture(GL_TEXTURE0 + unit);
+				activeUnit = unit;
+			}
+			glBindTexture(GL_TEXTURE_2D, texture);
+			textures[unit] = texture;
+		}
+	}
+
+	void forgetTexture(GLuint texture) {
+		// deleting a bound texture makes GL fall back to 0 on that unit
+		for (int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+			if (textures[i] == texture) {
+				textures[i] = 0;
+			}
+		}
+	}
+
+	void bindBuffer(GLenum target, GLuint buffer) {
+		GLuint& bound = target == GL_ELEMENT_ARRAY_BUFFER ? elementBuffer : arrayBuffer;
+		if (changed(bound != buffer)) {
+			glBindBuffer(target, buffer);
+			bound = buffer;
+		}
+	}
+
+	void forgetBuffer(GLuint buffer) {
+		if (arrayBuffer == buffer) {
+			arrayBuffer = 0;
+		}
+		if (elementBuffer == buffer) {
+			elementBuffer = 0;
+		}
+	}
+
+	void enableVertexAttribArray(GLint index) {
+		if (index < 0 || index >= MAX_ATTRIBS) {
+			return;
+		}
+		if (changed(attribs[index] != 1)) {
+			glEnableVertexAttribArray(index);
+			attribs[index] = 1;
+		}
+	}
+
+	void disableVertexAttribArray(GLint index) {
+		if (index < 0 || index >= MAX_ATTRIBS) {
+			return;
+		}
+		if (changed(attribs[index] != 0)) {
+			glDisableVertexAttribArray(index);
+			attribs[index] = 0;
+		}
+	}
+
+	void vertexAttribDivisor(GLint index, GLuint divisor) {
+		if (index < 0 || index >= MAX_ATTRIBS) {
+			return;
+		}
+		if (changed(divisors[index] != divisor)) {
+			glVertexAttribDivisor(index, divisor);
+			divisors[index] = divisor;
+		}
+	}
+
+	void setBlend(bool enabled) {
+		if (changed(blendEnabled != (enabled ? 1 : 0))) {
+			if (enabled) {
+				glEnable(GL_BLEND);
+			}
+			else {
+				glDisable(GL_BLEND);
+			}
+			blendEnabled = enabled ? 1 : 0;
+		}
+	}
+
+	void blendFunc(GLenum src, GLenum dst) {
+		if (changed(blendSrc != src || blendDst != dst)) {
+			glBlendFunc(src, dst);
+			blendSrc = src;
+			blendDst = dst;
+		}
+	}
+
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+		bool isDifferent = viewportValue[0] != x || viewportValue[1] != y
+			|| viewportValue[2] != width || viewportValue[3] != height;
+		if (changed(isDifferent)) {
+			glViewport(x, y, width, height);
+			viewportValue[0] = x;
+			viewportValue[1] = y;
+			viewportValue[2] = width;
+			viewportValue[3] = height;
+		}
+	}
+
+	void setScissor(bool enabled) {
+		if (changed(scissorEnabled != (enabled ? 1 : 0))) {
+			if (enabled) {
+				glEnable(GL_SCISSOR_TEST);
+			}
+			else {
+				glDisable(GL_SCISSOR_TEST);
+			}
+			scissorEnabled = enabled ? 1 : 0;
+		}
+	}
+
+	void scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+		bool isDifferent = scissorValue[0] != x || scissorValue[1] != y
+			|| scissorValue[2] != width || scissorValue[3] != height;
+		if (changed(isDifferent)) {
+			glScissor(x, y, width, height);
+			scissorValue[0] = x;
+			scissorValue[1] = y;
+			scissorValue[2] = width;
+			scissorValue[3] = height;
+		}
+	}
+
+	void endFrame() {
+		lastIssued = frameIssued;
+		lastElided = frameElided;
+		frameIssued = 0;
+		frameElided = 0;
+	}
+
+	void getStats(int* issued, int* elided) {
+		*issued = lastIssued;
+		*elided = lastElided;
+	}
+
+}
\ No newline at end of file
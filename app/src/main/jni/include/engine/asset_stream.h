@@ -0,0 +1,14 @@
+#ifndef CHICKPEA_ASSET_STREAM_H
+#define CHICKPEA_ASSET_STREAM_H
+
+namespace asset_stream {
+
+	unsigned char* loadImage(void*, const char*, int*, int*, int*);
+
+	void* mapAsset(void*, const char*, const unsigned char*, int, const unsigned char**, int*);
+
+	void closeAsset(void*);
+
+}
+
+#endif
\ No newline at end of file
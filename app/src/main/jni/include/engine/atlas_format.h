@@ -0,0 +1,34 @@
+#ifndef CHICKPEA_ATLAS_FORMAT_H
+#define CHICKPEA_ATLAS_FORMAT_H
+
+/**
+ * Binary atlas index written by tools/atlas_cooker and read by
+ * opengl_wrapper::loadAtlas. All integers are little-endian.
+ *
+ *   char[4] magic "CPAT"
+ *   u16     version
+ *   u16     page count
+ *   page count times:
+ *     u8    path length, followed by the asset path of the page image
+ *     u16   page width, u16 page height
+ *   u16     entry count
+ *   entry count times:
+ *     u8    label length, followed by the label
+ *     u16   page index
+ *     u16   x, y, width, height        trimmed rect inside the page
+ *     u16   sourceWidth, sourceHeight  size before trimming
+ *     u16   trimX, trimY               offset of the trimmed rect in the source
+ */
+namespace atlas_format {
+
+	static const char MAGIC[4] = {'C', 'P', 'A', 'T'};
+
+	static const int VERSION = 1;
+
+	static const int PADDING = 1;
+
+	static const int MAX_PAGE_SIZE = 2048;
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef CHICKPEA_CPTX_FORMAT_H
+#define CHICKPEA_CPTX_FORMAT_H
+
+/**
+ * The texture container written by tools/cptx_encoder and mapped by
+ * opengl_wrapper. Pixels are stored the way glTexImage2D takes them:
+ * premultiplied, already in their pixel_format, rows tightly packed, so an
+ * asset stored uncompressed is used straight from the mapped APK. The
+ * header fills the first ALIGNMENT bytes and every level starts at a
+ * multiple of ALIGNMENT from the start of the file. That is not a page
+ * boundary in memory: the APK only aligns stored assets to 4 bytes
+ * (zipalign -p page-aligns .so files alone), and uploads read with
+ * GL_UNPACK_ALIGNMENT 1, so nothing relies on more.
+ * All fields are little endian u32.
+ *
+ *   u8[4]  magic "CPTX"
+ *   u32    version
+ *   u32    pixelFormat, one of pixel_format
+ *   u32    sourceChannels, channel count of the image it was made from
+ *   u32    width, height
+ *   u32    levelCount, level 0 is full size and each next one halves
+ *   u32    offset, size of every level
+ */
+namespace cptx_format {
+
+	static const unsigned char MAGIC[4] = {'C', 'P', 'T', 'X'};
+
+	static const unsigned int VERSION = 1;
+
+	static const int HEADER_FIELDS = 6;
+
+	static const int MAX_LEVELS = 16;
+
+	static const int ALIGNMENT = 4096;
+
+}
+
+#endif
\ No newline at end of file
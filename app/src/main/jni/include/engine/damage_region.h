@@ -0,0 +1,32 @@
+#ifndef CHICKPEA_DAMAGE_REGION_H
+#define CHICKPEA_DAMAGE_REGION_H
+
+#include <stdint.h>
+
+#include <EGL/egl.h>
+
+#include <engine/sprite_batch.h>
+
+namespace damage_region {
+
+	void init(EGLDisplay);
+
+	bool isTracking();
+
+	void beginFrame(EGLDisplay, EGLSurface, int, int);
+
+	void setMatrices(const float*, const float*);
+
+	void addClear(const float*);
+
+	void add(const sprite_struct&, uint64_t);
+
+	bool resolve(int*);
+
+	EGLBoolean swap(EGLDisplay, EGLSurface);
+
+	void getStats(int*);
+
+}
+
+#endif
\ No newline at end of file
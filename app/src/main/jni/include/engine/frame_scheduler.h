@@ -0,0 +1,26 @@
+#ifndef CHICKPEA_FRAME_SCHEDULER_H
+#define CHICKPEA_FRAME_SCHEDULER_H
+
+#define FRAME_RATE_ADAPTIVE 0
+
+namespace frame_scheduler {
+
+	void setClock(double (*)(), void (*)(double));
+
+	void setFrameRate(int);
+
+	int getSwapInterval();
+
+	void beginFrame(double*, double*);
+
+	void endFrame();
+
+	void idleFrame();
+
+	void framePresented(double);
+
+	void getStats(float*, float*, int*);
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef CHICKPEA_GL_STATE_H
+#define CHICKPEA_GL_STATE_H
+
+#include <GLES3/gl3.h>
+
+namespace gl_state {
+
+	void reset();
+
+	void useProgram(GLuint);
+
+	void forgetProgram(GLuint);
+
+	GLint uniformLocation(GLuint, const char*);
+
+	GLint attribLocation(GLuint, const char*);
+
+	void uniformMatrix4(GLint, const GLfloat*);
+
+	void bindTexture(int, GLuint);
+
+	void forgetTexture(GLuint);
+
+	void bindBuffer(GLenum, GLuint);
+
+	void forgetBuffer(GLuint);
+
+	void enableVertexAttribArray(GLint);
+
+	void disableVertexAttribArray(GLint);
+
+	void vertexAttribDivisor(GLint, GLuint);
+
+	void setBlend(bool);
+
+	void blendFunc(GLenum, GLenum);
+
+	void viewport(GLint, GLint, GLsizei, GLsizei);
+
+	void setScissor(bool);
+
+	void scissor(GLint, GLint, GLsizei, GLsizei);
+
+	void endFrame();
+
+	void getStats(int*, int*);
+
+}
+
+#endif
\ No newline at end of file
@@ -2,9 +2,25 @@ namespace jx_wrapper {
 
 	void setReadFileParts(void*, int (*)(void*, const char*, char**));
 
-	void setCacheTextureCallback(void (*)(char*, char*));
+	void setCacheTextureCallback(void (*)(char*, char*, char*));
 
-	void setRenderCallback(void (*)(char*, float, float, float));
+	void setCacheTextureAsyncCallback(void (*)(char*, char*, char*));
+
+	void setCacheTexturesCallback(int (*)(char**, char**, char**, int));
+
+	void setLoadAtlasCallback(bool (*)(char*));
+
+	void setSetTextureBudgetCallback(void (*)(int));
+
+	void setSetFrameRateCallback(void (*)(int));
+
+	void setRenderCallback(void (*)(char*, float, float, float, float, float));
+
+	void setSetLayerCallback(void (*)(int));
+
+	void setSetLayerSortedCallback(void (*)(int, bool));
+
+	void setSetBlendModeCallback(void (*)(int));
 
 	void setSetCameraCallback(void (*)(float, float, float));
 
@@ -14,6 +30,8 @@ namespace jx_wrapper {
 
 	void setUnprojectCallback(void (*)(int, int, float*, float*));
 
+	void setGetRenderStatsCallback(void (*)(char*, int));
+
 	void setCacheSoundCallbacks(void*, void (*)(void*, const char*, char*), void (*)(void*, const char*, char*));
 
 	void setPlaySoundCallback(void (*)(bool));
@@ -0,0 +1,36 @@
+#ifndef CHICKPEA_KTX_FORMAT_H
+#define CHICKPEA_KTX_FORMAT_H
+
+/**
+ * The subset of KTX 1.1 written by tools/ktx_encoder and read by
+ * opengl_wrapper: one 2D image, one face, no array, no mipmaps, compressed
+ * (glType 0). The 64-byte header is thirteen u32 after the identifier, in
+ * the byte order given by the endianness field.
+ *
+ *   u8[12] identifier
+ *   u32    endianness, glType, glTypeSize, glFormat
+ *   u32    glInternalFormat, glBaseInternalFormat
+ *   u32    pixelWidth, pixelHeight, pixelDepth
+ *   u32    numberOfArrayElements, numberOfFaces, numberOfMipmapLevels
+ *   u32    bytesOfKeyValueData, followed by that many bytes
+ *   u32    imageSize, followed by the level 0 blocks
+ */
+namespace ktx_format {
+
+	static const unsigned char IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+	static const unsigned int ENDIANNESS = 0x04030201;
+
+	static const int HEADER_SIZE = 64;
+
+	static const unsigned int COMPRESSED_RGB8_ETC2 = 0x9274;
+
+	static const unsigned int COMPRESSED_RGBA8_ETC2_EAC = 0x9278;
+
+	static const unsigned int RGB = 0x1907;
+
+	static const unsigned int RGBA = 0x1908;
+
+}
+
+#endif
\ No newline at end of file
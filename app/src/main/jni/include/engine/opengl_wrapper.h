@@ -7,11 +7,33 @@ namespace opengl_wrapper {
 
 	uint createProgramBasic();
 
-	void cacheTexture(char*, char*);
+	void cacheTexture(char*, char*, char*);
+
+	void cacheTextureAsync(char*, char*, char*);
+
+	int cacheTextures(char**, char**, char**, int);
+
+	void uploadDecodedTextures();
+
+	bool takeFinishedTexture(char*, int, bool*);
+
+	void markDirty();
+
+	bool isIdle();
+
+	bool loadAtlas(char*);
+
+	void setTextureBudget(int);
 
 	void unprojectOnZeroLevel(int, int, float*, float*);
 
-	void render(char*, float, float, float);
+	void setLayer(int);
+
+	void setLayerSorted(int, bool);
+
+	void setBlendMode(int);
+
+	void render(char*, float, float, float, float, float);
 
 	void clearScreen(float, float, float);
 
@@ -19,12 +41,20 @@ namespace opengl_wrapper {
 
 	void getScreenDimensions(int*, int*);
 
-	void swapBuffers();
+	void getRenderStats(char*, int);
+
+	bool swapBuffers();
 
 	int init(global_struct*);
 
+	int resize(global_struct*);
+
+	void releaseWindow();
+
 	void destroy();
 
+	void shutdown();
+
 	void initProgram();
 
 }
\ No newline at end of file
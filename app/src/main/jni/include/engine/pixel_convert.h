@@ -0,0 +1,33 @@
+#ifndef CHICKPEA_PIXEL_CONVERT_H
+#define CHICKPEA_PIXEL_CONVERT_H
+
+#include <GLES3/gl3.h>
+
+enum pixel_format {
+	PIXEL_RGBA8 = 0,
+	PIXEL_RGB8 = 1,
+	PIXEL_RGB565 = 2,
+	PIXEL_RGBA4444 = 3,
+	PIXEL_L8 = 4,
+	PIXEL_LA8 = 5
+};
+
+namespace pixel_convert {
+
+	int formatFromHint(const char*, int);
+
+	const char* formatName(int);
+
+	int bytesPerPixel(int);
+
+	void glFormat(int, GLenum*, GLenum*);
+
+	bool isRenderable(int, bool);
+
+	void premultiply(unsigned char*, int, int);
+
+	void convert(const unsigned char*, int, int, int, unsigned char*);
+
+}
+
+#endif
\ No newline at end of file
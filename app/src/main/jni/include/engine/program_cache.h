@@ -0,0 +1,16 @@
+#ifndef CHICKPEA_PROGRAM_CACHE_H
+#define CHICKPEA_PROGRAM_CACHE_H
+
+#include <GLES3/gl3.h>
+
+namespace program_cache {
+
+	void init(const char*);
+
+	GLuint load(const char*, const char*);
+
+	void store(GLuint, const char*, const char*);
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef CHICKPEA_RECT_PACKER_H
+#define CHICKPEA_RECT_PACKER_H
+
+#include <vector>
+
+/**
+ * Skyline bottom-left rectangle packer. Doesn't touch GL, so both the runtime
+ * atlas and the offline cooker can share it.
+ */
+namespace rect_packer {
+
+	struct skyline_node {
+		int x, y, width;
+	};
+
+	struct packer {
+		int width, height, padding;
+		long usedArea;
+		std::vector<skyline_node> skyline;
+	};
+
+	void init(packer*, int, int, int);
+
+	bool insert(packer*, int, int, int*, int*);
+
+	void grow(packer*, int, int);
+
+	float fillRatio(const packer*);
+
+}
+
+#endif
\ No newline at end of file
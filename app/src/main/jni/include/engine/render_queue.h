@@ -0,0 +1,26 @@
+#ifndef CHICKPEA_RENDER_QUEUE_H
+#define CHICKPEA_RENDER_QUEUE_H
+
+#include <engine/sprite_batch.h>
+
+namespace render_queue {
+
+	void setLayerSorted(int, bool);
+
+	void setMatrices(const float*, const float*);
+
+	void submit(const sprite_struct&, int);
+
+	void clear(float, float, float);
+
+	bool publish(bool);
+
+	void execute(int);
+
+	void endFrame();
+
+	void getStats(int*, float*);
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,18 @@
+#ifndef CHICKPEA_RENDER_THREAD_H
+#define CHICKPEA_RENDER_THREAD_H
+
+namespace render_thread {
+
+	static const int SLOT_COUNT = 3;
+
+	void start(void (*)(int));
+
+	void stop();
+
+	int publish(int);
+
+	void runSync(void (*)(void*), void*);
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef CHICKPEA_SPRITE_BATCH_H
+#define CHICKPEA_SPRITE_BATCH_H
+
+#include <GLES3/gl3.h>
+
+enum blend_mode {
+	BLEND_ALPHA = 0,
+	BLEND_ADDITIVE = 1
+};
+
+/**
+ * One textured quad. quadRect is the model-space rect before rotation and
+ * scale, uvRect is (u0, v0, u1, v1) with v0 at the top row of the image.
+ * tint is premultiplied RGBA8 laid out in memory as r, g, b, a; a zero
+ * alpha with a non-zero color draws additively.
+ */
+struct sprite_struct {
+	GLuint texture;
+	float uvRect[4];
+	float quadRect[4];
+	float x, y, z;
+	float rotation, scale;
+	unsigned int tint;
+};
+
+namespace sprite_batch {
+
+	void init(GLuint, bool);
+
+	void destroy();
+
+	void setMatrices(const float*, const float*);
+
+	void add(const sprite_struct&);
+
+	void flush();
+
+	void endFrame();
+
+	void getStats(int*, int*, float*);
+
+}
+
+#endif
\ No newline at end of file
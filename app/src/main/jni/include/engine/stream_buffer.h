@@ -0,0 +1,20 @@
+#ifndef CHICKPEA_STREAM_BUFFER_H
+#define CHICKPEA_STREAM_BUFFER_H
+
+#include <GLES3/gl3.h>
+
+namespace stream_buffer {
+
+	void init(bool);
+
+	void destroy();
+
+	int write(const void*, int);
+
+	void endFrame();
+
+	void getStats(int*, float*);
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef CHICKPEA_TEXTURE_ATLAS_H
+#define CHICKPEA_TEXTURE_ATLAS_H
+
+#include <GLES3/gl3.h>
+
+namespace texture_atlas {
+
+	void init(bool);
+
+	void destroy();
+
+	void releaseRetired();
+
+	bool add(const char*, const unsigned char*, int, int, int);
+
+	int importPage(const unsigned char*, int);
+
+	int importCompressedPage(GLenum, const unsigned char*, int, int, int, int);
+
+	int adoptPage(GLuint, int, long, int, int, int);
+
+	void pinPage(int);
+
+	void addEntry(const char*, int, int, int, int, int, const float*);
+
+	bool lookup(const char*, GLuint*, float*, float*);
+
+	void nextFrame();
+
+	void setBudget(int);
+
+	void getStats(int*, float*, int*);
+
+	void getResidency(int*, int*, int*);
+
+}
+
+#endif
\ No newline at end of file
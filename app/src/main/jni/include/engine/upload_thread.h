@@ -0,0 +1,20 @@
+#ifndef CHICKPEA_UPLOAD_THREAD_H
+#define CHICKPEA_UPLOAD_THREAD_H
+
+#include <EGL/egl.h>
+
+namespace upload_thread {
+
+	bool start(EGLDisplay, EGLContext);
+
+	void stop();
+
+	bool isRunning();
+
+	void submit(void (*)(void*), void*);
+
+	bool takeCompleted(void**);
+
+}
+
+#endif
\ No newline at end of file
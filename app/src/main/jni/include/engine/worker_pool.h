@@ -0,0 +1,22 @@
+#ifndef CHICKPEA_WORKER_POOL_H
+#define CHICKPEA_WORKER_POOL_H
+
+namespace worker_pool {
+
+	static const int MAX_WORKERS = 8;
+
+	void start();
+
+	void stop();
+
+	void submit(void (*)(void*), void*);
+
+	int getWorkerCount();
+
+	bool takeCompleted(void**);
+
+	void waitCompleted(void**);
+
+}
+
+#endif
\ No newline at end of file
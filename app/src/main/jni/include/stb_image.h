@@ -3435,6 +3435,13 @@ static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
 
 // fast-way is faster to check than jpeg huffman, but slow way is slower
 #define STBI__ZFAST_BITS  9 // accelerate all cases in default tables
+
+// refill the bit buffer a word at a time, take a second literal per decode
+// when the bits are already there, and copy long-distance matches 8 bytes
+// at a time; the output is the same, STBI_NO_SIMD keeps the plain loops
+#ifndef STBI_NO_SIMD
+#define STBI__ZFAST_INFLATE
+#endif
 #define STBI__ZFAST_MASK  ((1 << STBI__ZFAST_BITS) - 1)
 
 // zlib-style huffman encoding
@@ -3541,6 +3548,20 @@ stbi_inline static stbi_uc stbi__zget8(stbi__zbuf *z)
 
 static void stbi__fill_bits(stbi__zbuf *z)
 {
+#ifdef STBI__ZFAST_INFLATE
+   if (z->zbuffer_end - z->zbuffer >= 4) {
+      // the same whole bytes the loop below would add, from one little-endian word
+      stbi_uc *p = z->zbuffer;
+      stbi__uint32 word = p[0] | (p[1] << 8) | (p[2] << 16) | ((stbi__uint32) p[3] << 24);
+      int n = (32 - z->num_bits) >> 3;
+      if (n < 4) word &= (1U << (n*8)) - 1;
+      STBI_ASSERT(z->code_buffer < (1U << z->num_bits));
+      z->code_buffer |= word << z->num_bits;
+      z->num_bits += n*8;
+      z->zbuffer += n;
+      return;
+   }
+#endif
    do {
       STBI_ASSERT(z->code_buffer < (1U << z->num_bits));
       z->code_buffer |= stbi__zget8(z) << z->num_bits;
@@ -3634,6 +3655,18 @@ static int stbi__parse_huffman_block(stbi__zbuf *a)
             zout = a->zout;
          }
          *zout++ = (char) z;
+#ifdef STBI__ZFAST_INFLATE
+         // literal runs are common; a second one needs neither a refill nor the slow path
+         if (a->num_bits >= STBI__ZFAST_BITS && zout < a->zout_end) {
+            int b = a->z_length.fast[a->code_buffer & STBI__ZFAST_MASK];
+            if (b && (b & 511) < 256) {
+               int s = b >> 9;
+               a->code_buffer >>= s;
+               a->num_bits -= s;
+               *zout++ = (char) (b & 511);
+            }
+         }
+#endif
       } else {
          stbi_uc *p;
          int len,dist;
@@ -3657,6 +3690,17 @@ static int stbi__parse_huffman_block(stbi__zbuf *a)
          if (dist == 1) { // run of one byte; common in images.
             stbi_uc v = *p;
             if (len) { do *zout++ = v; while (--len); }
+#ifdef STBI__ZFAST_INFLATE
+         } else if (dist >= 8 && zout + len + 8 <= a->zout_end) {
+            // chunks never overlap their source, and the overshoot stays inside the buffer
+            char *end = zout + len;
+            do {
+               memcpy(zout, p, 8);
+               zout += 8;
+               p += 8;
+            } while (zout < end);
+            zout = end;
+#endif
          } else {
             if (len) { do *zout++ = *p++; while (--len); }
          }
@@ -3952,6 +3996,167 @@ static int stbi__paeth(int a, int b, int c)
    return c;
 }
 
+// SIMD unfiltering for 8-bit rows written as four-byte pixels (RGBA, or RGB
+// widened to RGBA). The channels of a pixel are filtered in parallel; Sub,
+// Avg and Paeth still carry the left neighbour from pixel to pixel, Up on
+// RGBA runs 16 bytes at a time. Output is identical to the scalar loops.
+#if !defined(STBI_NO_SIMD) && (defined(STBI_SSE2) || defined(STBI__X64_TARGET) || defined(STBI_NEON))
+#define STBI__PNG_SIMD
+
+#ifdef STBI_NEON
+typedef uint8x8_t stbi__px;
+
+stbi_inline static stbi__px stbi__px_load(stbi__uint32 v) { return vreinterpret_u8_u32(vdup_n_u32(v)); }
+stbi_inline static stbi__uint32 stbi__px_bits(stbi__px v) { return vget_lane_u32(vreinterpret_u32_u8(v), 0); }
+stbi_inline static stbi__px stbi__px_add(stbi__px a, stbi__px b) { return vadd_u8(a, b); }
+stbi_inline static stbi__px stbi__px_avg(stbi__px a, stbi__px b) { return vhadd_u8(a, b); }
+
+stbi_inline static stbi__px stbi__px_paeth(stbi__px a, stbi__px b, stbi__px c)
+{
+   int16x8_t a16 = vreinterpretq_s16_u16(vmovl_u8(a));
+   int16x8_t b16 = vreinterpretq_s16_u16(vmovl_u8(b));
+   int16x8_t c16 = vreinterpretq_s16_u16(vmovl_u8(c));
+   int16x8_t da = vsubq_s16(b16, c16); // p-a
+   int16x8_t db = vsubq_s16(a16, c16); // p-b
+   int16x8_t pa = vabsq_s16(da);
+   int16x8_t pb = vabsq_s16(db);
+   int16x8_t pc = vabsq_s16(vaddq_s16(da, db));
+   uint16x8_t not_a = vorrq_u16(vcgtq_s16(pa, pb), vcgtq_s16(pa, pc));
+   int16x8_t bc = vbslq_s16(vcgtq_s16(pb, pc), c16, b16);
+   return vmovn_u16(vreinterpretq_u16_s16(vbslq_s16(not_a, bc, a16)));
+}
+
+static void stbi__png_add_rows(stbi_uc *cur, stbi_uc *prior, stbi_uc *raw, int n)
+{
+   int k = 0;
+   for (; k + 16 <= n; k += 16)
+      vst1q_u8(cur + k, vaddq_u8(vld1q_u8(raw + k), vld1q_u8(prior + k)));
+   for (; k < n; ++k)
+      cur[k] = STBI__BYTECAST(raw[k] + prior[k]);
+}
+#else
+#ifdef STBI__X64_TARGET
+#include <emmintrin.h>
+#endif
+typedef __m128i stbi__px;
+
+stbi_inline static stbi__px stbi__px_load(stbi__uint32 v) { return _mm_cvtsi32_si128((int) v); }
+stbi_inline static stbi__uint32 stbi__px_bits(stbi__px v) { return (stbi__uint32) _mm_cvtsi128_si32(v); }
+stbi_inline static stbi__px stbi__px_add(stbi__px a, stbi__px b) { return _mm_add_epi8(a, b); }
+
+stbi_inline static stbi__px stbi__px_avg(stbi__px a, stbi__px b)
+{
+   // pavgb rounds up, PNG rounds down
+   return _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+}
+
+stbi_inline static stbi__px stbi__px_paeth(stbi__px a, stbi__px b, stbi__px c)
+{
+   __m128i zero = _mm_setzero_si128();
+   __m128i a16 = _mm_unpacklo_epi8(a, zero);
+   __m128i b16 = _mm_unpacklo_epi8(b, zero);
+   __m128i c16 = _mm_unpacklo_epi8(c, zero);
+   __m128i da = _mm_sub_epi16(b16, c16); // p-a
+   __m128i db = _mm_sub_epi16(a16, c16); // p-b
+   __m128i dc = _mm_add_epi16(da, db);   // p-c
+   __m128i pa = _mm_max_epi16(da, _mm_sub_epi16(zero, da));
+   __m128i pb = _mm_max_epi16(db, _mm_sub_epi16(zero, db));
+   __m128i pc = _mm_max_epi16(dc, _mm_sub_epi16(zero, dc));
+   __m128i not_a = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+   __m128i use_c = _mm_cmpgt_epi16(pb, pc);
+   __m128i bc = _mm_or_si128(_mm_and_si128(use_c, c16), _mm_andnot_si128(use_c, b16));
+   __m128i res = _mm_or_si128(_mm_and_si128(not_a, bc), _mm_andnot_si128(not_a, a16));
+   return _mm_packus_epi16(res, res);
+}
+
+static void stbi__png_add_rows(stbi_uc *cur, stbi_uc *prior, stbi_uc *raw, int n)
+{
+   int k = 0;
+   for (; k + 16 <= n; k += 16)
+      _mm_storeu_si128((__m128i *) (cur + k), _mm_add_epi8(_mm_loadu_si128((__m128i *) (raw + k)), _mm_loadu_si128((__m128i *) (prior + k))));
+   for (; k < n; ++k)
+      cur[k] = STBI__BYTECAST(raw[k] + prior[k]);
+}
+#endif
+
+static int stbi__png_simd_available(void)
+{
+#ifdef STBI__X86_TARGET
+   return stbi__sse2_available();
+#else
+   return 1;
+#endif
+}
+
+stbi_inline static stbi__px stbi__png_load4(stbi_uc *p)
+{
+   stbi__uint32 v;
+   memcpy(&v, p, 4);
+   return stbi__px_load(v);
+}
+
+// widened RGB is opaque; lanes are little-endian, so alpha is the top byte
+stbi_inline static stbi__px stbi__png_load3(stbi_uc *p)
+{
+   return stbi__px_load(p[0] | (p[1] << 8) | (p[2] << 16));
+}
+
+stbi_inline static void stbi__png_store4(stbi_uc *p, stbi__px v)
+{
+   stbi__uint32 bits = stbi__px_bits(v);
+   memcpy(p, &bits, 4);
+}
+
+stbi_inline static void stbi__png_store3(stbi_uc *p, stbi__px v)
+{
+   stbi__uint32 bits = stbi__px_bits(v) | 0xff000000u;
+   memcpy(p, &bits, 4);
+}
+
+// unfilters the `count` pixels after the first one; raw has raw_n bytes per pixel, cur and prior four.
+// returns 0 for the cases the scalar loops already do as well
+static int stbi__create_png_row_simd(int filter, stbi_uc *cur, stbi_uc *prior, stbi_uc *raw, int count, int raw_n)
+{
+   stbi__px zero = stbi__px_load(0);
+   stbi__px a, b, c;
+   int i;
+
+   if (raw_n == 4 && filter == STBI__F_up) {
+      stbi__png_add_rows(cur, prior, raw, count * 4);
+      return 1;
+   }
+   if (filter == STBI__F_none || filter == STBI__F_up)
+      return 0;
+
+   // the alpha lane of a widened pixel only ever feeds its own lane, so it is fixed up on store
+   a = stbi__png_load4(cur - 4);
+   #define STBI__PX_LOOP(n, body) \
+      for (i=0; i < count; ++i, cur += 4, prior += 4, raw += n) { \
+         body; \
+         stbi__png_store##n(cur, a); \
+      }
+   #define STBI__PX_FILTERS(n) \
+      switch (filter) { \
+         case STBI__F_sub:          STBI__PX_LOOP(n, a = stbi__px_add(stbi__png_load##n(raw), a)) break; \
+         case STBI__F_avg:          STBI__PX_LOOP(n, b = stbi__png_load4(prior); a = stbi__px_add(stbi__png_load##n(raw), stbi__px_avg(a, b))) break; \
+         case STBI__F_paeth: \
+            c = stbi__png_load4(prior - 4); \
+            STBI__PX_LOOP(n, b = stbi__png_load4(prior); a = stbi__px_add(stbi__png_load##n(raw), stbi__px_paeth(a, b, c)); c = b) \
+            break; \
+         case STBI__F_avg_first:    STBI__PX_LOOP(n, a = stbi__px_add(stbi__png_load##n(raw), stbi__px_avg(a, zero))) break; \
+         case STBI__F_paeth_first:  STBI__PX_LOOP(n, a = stbi__px_add(stbi__png_load##n(raw), a)) break; /* paeth(a,0,0) is a */ \
+      }
+   if (raw_n == 4) {
+      STBI__PX_FILTERS(4)
+   } else {
+      STBI__PX_FILTERS(3)
+   }
+   #undef STBI__PX_FILTERS
+   #undef STBI__PX_LOOP
+   return 1;
+}
+#endif
+
 static stbi_uc stbi__depth_scale_table[9] = { 0, 0xff, 0x55, 0, 0x11, 0,0,0, 0x01 };
 
 // create the png data from post-deflated data
@@ -3962,6 +4167,9 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
    stbi__uint32 img_len, img_width_bytes;
    int k;
    int img_n = s->img_n; // copy it into a local for later
+#ifdef STBI__PNG_SIMD
+   int simd = depth == 8 && (img_n == 3 || img_n == 4) && out_n == 4 && stbi__png_simd_available();
+#endif
 
    STBI_ASSERT(out_n == s->img_n || out_n == s->img_n+1);
    a->out = (stbi_uc *) stbi__malloc(x * y * out_n); // extra bytes to write off the end into
@@ -4019,6 +4227,13 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
          prior += 1;
       }
 
+#ifdef STBI__PNG_SIMD
+      if (simd && stbi__create_png_row_simd(filter, cur, prior, raw, x-1, img_n)) {
+         raw += (x-1)*img_n;
+         continue;
+      }
+#endif
+
       // this is a little gross, so that we don't switch per-pixel or per-component
       if (depth < 8 || img_n == out_n) {
          int nk = (width - 1)*img_n;
@@ -6,6 +6,8 @@
 #include <jx.h>
 #include <jx_result.h>
 
+#include <stdlib.h>
+#include <string.h>
 #include <string>
 
 namespace jx_wrapper {
@@ -35,22 +37,142 @@ namespace jx_wrapper {
 	}
 
 
-	void (*cacheTextureCallback)(char*, char*);
+	void (*cacheTextureCallback)(char*, char*, char*);
 
 	void cacheTexture(JXValue *results, int argc) {
 		char* lable = (char*) JX_GetString(&results[0]);
 		char* path = (char*) JX_GetString(&results[1]);
+		char* formatHint = NULL;
 
-		cacheTextureCallback(lable, path);
+		if (argc > 2 && JX_IsString(&results[2]))
+			formatHint = JX_GetString(&results[2]);
+
+		cacheTextureCallback(lable, path, formatHint);
+
+		if (formatHint != NULL)
+			free(formatHint);
 	}
 
-	void setCacheTextureCallback(void (*callback)(char*, char*)) {
+	void setCacheTextureCallback(void (*callback)(char*, char*, char*)) {
 		cacheTextureCallback = callback;
 
 		JX_DefineExtension("cacheTexture", cacheTexture);
 	}
 
-	void (*renderCallback)(char*, float, float, float);
+	void (*cacheTextureAsyncCallback)(char*, char*, char*);
+
+	void cacheTextureAsync(JXValue *results, int argc) {
+		char* label = (char*) JX_GetString(&results[0]);
+		char* path = (char*) JX_GetString(&results[1]);
+		char* formatHint = NULL;
+
+		if (argc > 2 && JX_IsString(&results[2]))
+			formatHint = JX_GetString(&results[2]);
+
+		cacheTextureAsyncCallback(label, path, formatHint);
+
+		if (formatHint != NULL)
+			free(formatHint);
+	}
+
+	void setCacheTextureAsyncCallback(void (*callback)(char*, char*, char*)) {
+		cacheTextureAsyncCallback = callback;
+
+		JX_DefineExtension("cacheTextureAsync", cacheTextureAsync);
+	}
+
+	int (*cacheTexturesCallback)(char**, char**, char**, int);
+
+	void cacheTextures(JXValue *results, int argc) {
+		JXValue length;
+		JX_GetNamedProperty(&results[0], "length", &length);
+		int count = JX_GetInt32(&length);
+		JX_Free(&length);
+
+		char** labels = (char**) calloc(count * 3 + 1, sizeof(char*));
+		char** paths = labels + count;
+		char** formatHints = paths + count;
+
+		// each entry is [label, path] or [label, path, format]
+		int valid = 0;
+		for (int i = 0; i < count; i++) {
+			JXValue entry, label, path, formatHint;
+			JX_GetIndexedProperty(&results[0], i, &entry);
+			JX_GetIndexedProperty(&entry, 0, &label);
+			JX_GetIndexedProperty(&entry, 1, &path);
+			JX_GetIndexedProperty(&entry, 2, &formatHint);
+
+			if (JX_IsString(&label) && JX_IsString(&path)) {
+				labels[valid] = JX_GetString(&label);
+				paths[valid] = JX_GetString(&path);
+				formatHints[valid] = JX_IsString(&formatHint) ? JX_GetString(&formatHint) : NULL;
+				valid++;
+			}
+			else {
+				LOGE("cacheTextures entry %i is not [label, path]", i);
+			}
+
+			JX_Free(&formatHint);
+			JX_Free(&path);
+			JX_Free(&label);
+			JX_Free(&entry);
+		}
+
+		JX_SetInt32(&results[argc], cacheTexturesCallback(labels, paths, formatHints, valid));
+
+		for (int i = 0; i < valid; i++) {
+			free(labels[i]);
+			free(paths[i]);
+			free(formatHints[i]);
+		}
+		free(labels);
+	}
+
+	void setCacheTexturesCallback(int (*callback)(char**, char**, char**, int)) {
+		cacheTexturesCallback = callback;
+
+		JX_DefineExtension("cacheTextures", cacheTextures);
+	}
+
+	bool (*loadAtlasCallback)(char*);
+
+	void loadAtlas(JXValue *results, int argc) {
+		char* path = (char*) JX_GetString(&results[0]);
+
+		JX_SetBoolean(&results[argc], loadAtlasCallback(path));
+	}
+
+	void setLoadAtlasCallback(bool (*callback)(char*)) {
+		loadAtlasCallback = callback;
+
+		JX_DefineExtension("loadAtlas", loadAtlas);
+	}
+
+	void (*setTextureBudgetCallback)(int);
+
+	void setTextureBudget(JXValue *results, int argc) {
+		setTextureBudgetCallback(JX_GetInt32(&results[0]));
+	}
+
+	void setSetTextureBudgetCallback(void (*callback)(int)) {
+		setTextureBudgetCallback = callback;
+
+		JX_DefineExtension("setTextureBudget", setTextureBudget);
+	}
+
+	void (*setFrameRateCallback)(int);
+
+	void setFrameRate(JXValue *results, int argc) {
+		setFrameRateCallback(JX_GetInt32(&results[0]));
+	}
+
+	void setSetFrameRateCallback(void (*callback)(int)) {
+		setFrameRateCallback = callback;
+
+		JX_DefineExtension("setFrameRate", setFrameRate);
+	}
+
+	void (*renderCallback)(char*, float, float, float, float, float);
 
 	void render(JXValue *results, int argc) {
 		char* label = (char*) JX_GetString(&results[0]);
@@ -68,14 +190,69 @@ namespace jx_wrapper {
 		if (argc > 3)
 			offsetZ = (float) JX_GetDouble(&results[3]);
 
-		renderCallback(label, offsetX, offsetY, offsetZ);
+		float rotation = 0;
+		float scale = 1;
+
+		if (argc > 4)
+			rotation = (float) JX_GetDouble(&results[4]);
+
+		if (argc > 5)
+			scale = (float) JX_GetDouble(&results[5]);
+
+		renderCallback(label, offsetX, offsetY, offsetZ, rotation, scale);
 	}
 
-	void setRenderCallback(void (*callback)(char*, float, float, float)) {
+	void setRenderCallback(void (*callback)(char*, float, float, float, float, float)) {
 		renderCallback = callback;
 		JX_DefineExtension("render", render);
 	}
 
+	void (*setLayerCallback)(int);
+
+	void setLayer(JXValue *results, int argc) {
+		setLayerCallback(argc > 0 ? JX_GetInt32(&results[0]) : 0);
+	}
+
+	void setSetLayerCallback(void (*callback)(int)) {
+		setLayerCallback = callback;
+		JX_DefineExtension("setLayer", setLayer);
+	}
+
+	void (*setLayerSortedCallback)(int, bool);
+
+	void setLayerSorted(JXValue *results, int argc) {
+		int layer = JX_GetInt32(&results[0]);
+		bool sorted = argc > 1 ? JX_GetBoolean(&results[1]) : true;
+
+		setLayerSortedCallback(layer, sorted);
+	}
+
+	void setSetLayerSortedCallback(void (*callback)(int, bool)) {
+		setLayerSortedCallback = callback;
+		JX_DefineExtension("setLayerSorted", setLayerSorted);
+	}
+
+	void (*setBlendModeCallback)(int);
+
+	void setBlendMode(JXValue *results, int argc) {
+		int blend = 0;
+
+		if (argc > 0 && JX_IsString(&results[0])) {
+			char* mode = JX_GetString(&results[0]);
+			blend = strcmp(mode, "additive") == 0 ? 1 : 0;
+			free(mode);
+		}
+		else if (argc > 0)
+			blend = JX_GetInt32(&results[0]);
+
+		setBlendModeCallback(blend);
+	}
+
+	void setSetBlendModeCallback(void (*callback)(int)) {
+		setBlendModeCallback = callback;
+		JX_DefineExtension("setBlendMode", setBlendMode);
+	}
+
 	void (*setCameraCallback)(float, float, float);
 
 	void setCamera(JXValue *results, int argc) {
@@ -162,6 +339,20 @@ namespace jx_wrapper {
 		JX_DefineExtension("unproject", unproject);
 	}
 
+	void (*getRenderStatsCallback)(char*, int);
+
+	void getRenderStats(JXValue *results, int argc) {
+		char data[2048];
+		getRenderStatsCallback(data, sizeof(data));
+
+		JX_SetJSON(&results[argc], data, strlen(data));
+	}
+
+	void setGetRenderStatsCallback(void (*callback)(char*, int)) {
+		getRenderStatsCallback = callback;
+		JX_DefineExtension("getRenderStats", getRenderStats);
+	}
+
 	void* assetManagerForSound;
 	void (*backgroundCacheSound)(void*, const char*, char*);
 	void (*actionCacheSound)(void*, const char*, char*);
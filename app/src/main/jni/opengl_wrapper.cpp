@@ -1,8 +1,18 @@
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <deque>
 #include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
 #include <GLES3/gl3.h>
 
 #define GLM_FORCE_PURE
@@ -11,49 +21,62 @@
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// stb_image only uses NEON when told to; PNG unfiltering and JPEG IDCT share the switch
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define STBI_NEON
+#endif
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 #include <integration_contract.h>
 
+#include <engine/sprite_batch.h>
+#include <engine/render_queue.h>
+#include <engine/render_thread.h>
+#include <engine/gl_state.h>
+#include <engine/stream_buffer.h>
+#include <engine/texture_atlas.h>
+#include <engine/atlas_format.h>
+#include <engine/ktx_format.h>
+#include <engine/cptx_format.h>
+#include <engine/pixel_convert.h>
+#include <engine/worker_pool.h>
+#include <engine/upload_thread.h>
+#include <engine/program_cache.h>
+#include <engine/frame_scheduler.h>
+#include <engine/damage_region.h>
+#include <engine/asset_stream.h>
+
 #include <android/log.h>
 
 #define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, "opengl_wrapper", __VA_ARGS__))
 #define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, "opengl_wrapper", __VA_ARGS__))
 
+#ifndef EGL_OPENGL_ES3_BIT_KHR
+#define EGL_OPENGL_ES3_BIT_KHR 0x0040
+#endif
+
 namespace opengl_wrapper {
 
 	static glm::mat4x4 mProjMatrix;
+	static glm::mat4 viewMatrix = glm::lookAt(glm::vec3(0,0,0), glm::vec3(0,0,0), glm::vec3(0,1,0));
+	static glm::mat4 unprojectViewMatrix = glm::lookAt(glm::vec3(0,0,0), glm::vec3(0,0,0), glm::vec3(0,1,0));
 
 	static unsigned char *textureData;
 
-	static char VERTEX_SHADER[] =
-		"#version 100\n"
-
-		"attribute vec4 a_Position;\n"
-
-		"void main() {\n"
-		"   gl_Position = a_Position;\n"
-		"}\n";   
-
-	static char FRAGMENT_SHADER[] =
-		"#version 100\n"
-		"precision mediump float;\n"
-
-		"void main(){\n"
-		"	gl_FragColor = vec4(0.2, 1.0, 0.0, 1.0);\n"
-		"}\n";
-
 	static char VERTEX_SHADER_WITH_TEXTURE[] =
 		"#version 100\n"
 		"uniform mat4 u_Projection, u_ModelView;\n"
 		"attribute vec4 a_Position;\n"
 		"attribute vec2 a_TextureUV;\n"
+		"attribute vec4 a_Tint;\n"
  
 		"varying vec2 v_TextureCoord;\n"
+		"varying vec4 v_Tint;\n"
 
 		"void main() {\n"
 		"	v_TextureCoord = a_TextureUV;\n"
+		"	v_Tint = a_Tint;\n"
 		"	gl_Position = u_Projection * u_ModelView * a_Position;\n"
 		"}\n";
 
@@ -63,8 +86,44 @@ namespace opengl_wrapper {
 		"uniform sampler2D tex;\n"
 
 		"varying vec2 v_TextureCoord;\n"
+		"varying vec4 v_Tint;\n"
+		"void main() {\n"
+		"	gl_FragColor = texture2D(tex, v_TextureCoord) * v_Tint;\n"
+		"}\n";
+
+	static char VERTEX_SHADER_INSTANCED[] =
+		"#version 300 es\n"
+		"uniform mat4 u_Projection, u_ModelView;\n"
+		"in vec2 a_Corner;\n"
+		"in vec4 a_Transform;\n"
+		"in vec2 a_Scale;\n"
+		"in vec4 a_UVRect;\n"
+		"in vec4 a_Tint;\n"
+
+		"out vec2 v_TextureCoord;\n"
+		"out vec4 v_Tint;\n"
+
+		"void main() {\n"
+		"	vec2 local = a_Corner * a_Scale;\n"
+		"	float c = cos(a_Transform.w);\n"
+		"	float s = sin(a_Transform.w);\n"
+		"	vec2 world = vec2(local.x * c - local.y * s, local.x * s + local.y * c) + a_Transform.xy;\n"
+		"	vec2 t = a_Corner * 0.5 + 0.5;\n"
+		"	v_TextureCoord = vec2(mix(a_UVRect.x, a_UVRect.z, t.x), mix(a_UVRect.w, a_UVRect.y, t.y));\n"
+		"	v_Tint = a_Tint;\n"
+		"	gl_Position = u_Projection * u_ModelView * vec4(world, a_Transform.z, 1.0);\n"
+		"}\n";
+
+	static char FRAGMENT_SHADER_INSTANCED[] =
+		"#version 300 es\n"
+		"precision mediump float;\n"
+		"uniform sampler2D tex;\n"
+
+		"in vec2 v_TextureCoord;\n"
+		"in vec4 v_Tint;\n"
+		"out vec4 fragColor;\n"
 		"void main() {\n"
-		"	gl_FragColor = texture2D(tex, v_TextureCoord);\n"
+		"	fragColor = texture(tex, v_TextureCoord) * v_Tint;\n"
 		"}\n";
 
 	static bool checkGlError(const char* funcName) {
@@ -105,7 +164,7 @@ namespace opengl_wrapper {
 		return shader;
 	}
 
-	static GLuint createProgram(const char* vtxSrc, const char* fragSrc) {
+	static GLuint createProgram(const char* vtxSrc, const char* fragSrc, bool retrievable = false) {
 		GLuint vtxShader = 0;
 		GLuint fragShader = 0;
 		GLuint program = 0;
@@ -127,6 +186,10 @@ namespace opengl_wrapper {
 		glAttachShader(program, vtxShader);
 		glAttachShader(program, fragShader);
 
+		if (retrievable) {
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+
 		glLinkProgram(program);
 		glGetProgramiv(program, GL_LINK_STATUS, &linked);
 		if (!linked) {
@@ -154,61 +217,910 @@ namespace opengl_wrapper {
 	static EGLDisplay display;
 	static EGLSurface surface;
 	static EGLContext context;
-	static GLuint textureID;
-
-	static std::map<std::string, int> textureCache;
+	static GLuint mProgram;
 
 	static int (*readBinaryFile)(void*, const char*, unsigned char**);
 	static void* assetManager;
 
-	void cacheTexture(char* label, char* path) {
+	// decoding stays on the calling thread, only the upload runs where the context is
+	struct upload_struct {
+		const char* label;
+		const unsigned char* rgba;
+		int width, height;
+		int page;
+		GLenum format;
+		int dataSize;
+		int padding;
+		int pixelFormat;
+	};
+
+	static void addToAtlas(void* argument) {
+		upload_struct* upload = (upload_struct*) argument;
+		texture_atlas::add(upload->label, upload->rgba, upload->width, upload->height, upload->pixelFormat);
+	}
+
+	static void importAtlasPage(void* argument) {
+		upload_struct* upload = (upload_struct*) argument;
+		upload->page = texture_atlas::importPage(upload->rgba, upload->width);
+	}
+
+	static void importCompressedPage(void* argument) {
+		upload_struct* upload = (upload_struct*) argument;
+		upload->page = texture_atlas::importCompressedPage(upload->format, upload->rgba, upload->dataSize,
+			upload->width, upload->height, upload->padding);
+	}
+
+	static bool isES3 = false;
+
+	/* Accepts the single level, native byte order ETC2 files written by tools/ktx_encoder. */
+	static bool parseKtx(const unsigned char* file, int fileSize, upload_struct* upload) {
+		if (fileSize < ktx_format::HEADER_SIZE + 4 || memcmp(file, ktx_format::IDENTIFIER, sizeof(ktx_format::IDENTIFIER)) != 0) {
+			return false;
+		}
+
+		unsigned int header[13];
+		memcpy(header, file + sizeof(ktx_format::IDENTIFIER), sizeof(header));
+		if (header[0] != ktx_format::ENDIANNESS || header[1] != 0) {
+			return false;
+		}
+		if (header[4] != ktx_format::COMPRESSED_RGB8_ETC2 && header[4] != ktx_format::COMPRESSED_RGBA8_ETC2_EAC) {
+			return false;
+		}
+
+		unsigned int offset = ktx_format::HEADER_SIZE + header[12];
+		unsigned int imageSize;
+		if (offset + 4 > (unsigned int) fileSize) {
+			return false;
+		}
+		memcpy(&imageSize, file + offset, 4);
+		if (offset + 4 + imageSize > (unsigned int) fileSize) {
+			return false;
+		}
+
+		upload->format = header[4];
+		upload->width = header[6];
+		upload->height = header[7];
+		upload->rgba = file + offset + 4;
+		upload->dataSize = imageSize;
+		return true;
+	}
+
+	/* Reads the .ktx next to an image; the caller frees *file, which upload points into. */
+	static bool readCompressed(const char* path, int padding, unsigned char** file, upload_struct* upload) {
+		// ETC2 is only guaranteed from GLES 3.0 on
+		if (!isES3) {
+			return false;
+		}
+
+		std::string ktxPath(path);
+		size_t dot = ktxPath.find_last_of('.');
+		if (dot == std::string::npos) {
+			return false;
+		}
+		ktxPath = ktxPath.substr(0, dot) + ".ktx";
+
 		unsigned char* data;
-		int byteCountToRead = readBinaryFile(assetManager, path, &data);
+		int size = readBinaryFile(assetManager, ktxPath.c_str(), &data);
+		if (size < 0) {
+			return false;
+		}
+
+		upload_struct parsed = {NULL, NULL, 0, 0, -1, 0, 0, padding};
+		if (!parseKtx(data, size, &parsed)) {
+			LOGE("%s is not a supported KTX file", ktxPath.c_str());
+			free(data);
+			return false;
+		}
+
+		*upload = parsed;
+		*file = data;
+		return true;
+	}
+
+	/* Uploads the .ktx next to an image as its own size x size page, -1 if there is none or it can't be used. */
+	static int loadCompressed(const char* path, int padding, int size) {
+		unsigned char* file;
+		upload_struct upload;
+		if (!readCompressed(path, padding, &file, &upload)) {
+			return -1;
+		}
+
+		// checked before the upload, a page of the wrong size would only sit in the atlas unused
+		if (upload.width != size || upload.height != size) {
+			LOGE("Compressed page for %s is %ix%i, expected %ix%i", path, upload.width, upload.height, size, size);
+			free(file);
+			return -1;
+		}
+
+		render_thread::runSync(importCompressedPage, &upload);
+		free(file);
+		return upload.page;
+	}
+
+	// the CPU half of loading a texture, which doesn't need the context
+	struct decoded_texture {
+		upload_struct upload;
+		bool compressed;
+		unsigned char* file;
+		unsigned char* imageData;
+		unsigned char* pixels;
+		// a container stays mapped from the asset until the upload is done
+		bool container;
+		void* asset;
+		int levels;
+		const unsigned char* levelData[cptx_format::MAX_LEVELS];
+	};
+
+	// upload-ready copies of decoded textures, so a lost context or an evicted
+	// page comes back without decoding the image again
+	struct cached_texture {
+		upload_struct upload;
+		bool compressed;
+		std::vector<unsigned char> data;
+	};
+
+	static const long CPU_CACHE_LIMIT = 16L << 20;
+
+	// workers read and fill it too; entries are only dropped by shutdown()
+	static pthread_mutex_t cpuCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+	static std::map<std::string, cached_texture> cpuCache;
+	static long cpuCacheBytes = 0;
+
+	static std::string cacheKey(const char* path, const char* formatHint) {
+		return std::string(path) + '\n' + (formatHint != NULL ? formatHint : "");
+	}
+
+	static bool takeFromCache(const std::string& key, bool allowCompressed, decoded_texture* decoded) {
+		pthread_mutex_lock(&cpuCacheMutex);
+		std::map<std::string, cached_texture>::iterator found = cpuCache.find(key);
+		bool usable = found != cpuCache.end() && (allowCompressed || !found->second.compressed);
+		if (usable) {
+			decoded->upload = found->second.upload;
+			decoded->upload.rgba = &found->second.data[0];
+			decoded->compressed = found->second.compressed;
+		}
+		pthread_mutex_unlock(&cpuCacheMutex);
+
+		return usable;
+	}
+
+	static void addToCache(const std::string& key, const decoded_texture* decoded) {
+		const upload_struct& upload = decoded->upload;
+		long size = decoded->compressed ? upload.dataSize : (long) upload.width * upload.height * pixel_convert::bytesPerPixel(upload.pixelFormat);
+
+		pthread_mutex_lock(&cpuCacheMutex);
+		if (cpuCache.count(key) == 0 && cpuCacheBytes + size <= CPU_CACHE_LIMIT) {
+			cached_texture& cached = cpuCache[key];
+			cached.upload = upload;
+			cached.compressed = decoded->compressed;
+			cached.data.assign(upload.rgba, upload.rgba + size);
+			cpuCacheBytes += size;
+		}
+		pthread_mutex_unlock(&cpuCacheMutex);
+	}
+
+	static unsigned int readU32(const unsigned char* data) {
+		return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int) data[3] << 24);
+	}
+
+	/* Checks every level of a container against the size of the mapped file. */
+	static bool parseContainer(const unsigned char* file, int fileSize, decoded_texture* decoded) {
+		const int fixedSize = 4 + cptx_format::HEADER_FIELDS * 4;
+		if (fileSize < fixedSize || readU32(file + 4) != cptx_format::VERSION) {
+			return false;
+		}
+
+		unsigned int format = readU32(file + 8);
+		unsigned int width = readU32(file + 16);
+		unsigned int height = readU32(file + 20);
+		unsigned int levels = readU32(file + 24);
+		if (format > PIXEL_LA8 || width == 0 || height == 0 || width > 16384 || height > 16384
+				|| levels == 0 || levels > (unsigned int) cptx_format::MAX_LEVELS || fixedSize + levels * 8 > (unsigned int) fileSize) {
+			return false;
+		}
+
+		long total = 0;
+		for (unsigned int level = 0; level < levels; level++) {
+			unsigned int offset = readU32(file + fixedSize + level * 8);
+			unsigned int size = readU32(file + fixedSize + level * 8 + 4);
+			unsigned int levelWidth = width >> level > 0 ? width >> level : 1;
+			unsigned int levelHeight = height >> level > 0 ? height >> level : 1;
+			if (size != levelWidth * levelHeight * pixel_convert::bytesPerPixel(format) || offset % cptx_format::ALIGNMENT != 0 || offset > (unsigned int) fileSize || size > fileSize - offset) {
+				return false;
+			}
+			decoded->levelData[level] = file + offset;
+			total += size;
+		}
+
+		upload_struct upload = {NULL, decoded->levelData[0], (int) width, (int) height, -1, 0, (int) total, 0, (int) format};
+		decoded->upload = upload;
+		decoded->levels = levels;
+		return true;
+	}
+
+	/* Maps the .cptx next to an image, or the path itself if it names one, for an upload without decoding. */
+	static bool readContainer(const char* path, const char* formatHint, decoded_texture* decoded) {
+		// one probe per image: a plain image is never opened just to read its magic
+		std::string containerPath(path);
+		size_t dot = containerPath.find_last_of('.');
+		containerPath = (dot != std::string::npos ? containerPath.substr(0, dot) : containerPath) + ".cptx";
+
+		const unsigned char* file;
+		int size;
+		void* asset = asset_stream::mapAsset(assetManager, containerPath.c_str(), cptx_format::MAGIC, sizeof(cptx_format::MAGIC), &file, &size);
+		if (asset == NULL) {
+			return false;
+		}
+
+		if (!parseContainer(file, size, decoded)) {
+			LOGE("%s is not a supported texture container", containerPath.c_str());
+			asset_stream::closeAsset(asset);
+			return false;
+		}
+
+		// cooked for another format than this call asks for
+		int format = pixel_convert::formatFromHint(formatHint, (int) readU32(file + 12));
+		if (format != decoded->upload.pixelFormat) {
+			LOGI("%s holds %s, decoding the image for %s", containerPath.c_str(),
+				pixel_convert::formatName(decoded->upload.pixelFormat), pixel_convert::formatName(format));
+			asset_stream::closeAsset(asset);
+			return false;
+		}
+
+		// ES2 only mipmaps power of two sizes
+		int width = decoded->upload.width, height = decoded->upload.height;
+		if (!isES3 && ((width & (width - 1)) != 0 || (height & (height - 1)) != 0)) {
+			decoded->levels = 1;
+			decoded->upload.dataSize = width * height * pixel_convert::bytesPerPixel(decoded->upload.pixelFormat);
+		}
+
+		decoded->container = true;
+		decoded->asset = asset;
+		return true;
+	}
 
+	static bool decodeTexture(const char* path, const char* formatHint, bool allowCompressed, decoded_texture* decoded) {
+		decoded->compressed = false;
+		decoded->file = NULL;
+		decoded->imageData = NULL;
+		decoded->pixels = NULL;
+		decoded->container = false;
+		decoded->asset = NULL;
+		decoded->levels = 0;
+
+		std::string key = cacheKey(path, formatHint);
+		if (takeFromCache(key, allowCompressed, decoded)) {
+			return true;
+		}
+
+		if (allowCompressed && readCompressed(path, 0, &decoded->file, &decoded->upload)) {
+			decoded->compressed = true;
+			addToCache(key, decoded);
+			return true;
+		}
+
+		// mapping it again is as cheap as the CPU cache, so it isn't copied there
+		if (allowCompressed && readContainer(path, formatHint, decoded)) {
+			return true;
+		}
+
+		// decoded from the asset itself, the compressed file never sits on the heap
 		int w2,h2,n2;
-		unsigned char* imageData = stbi_load_from_memory(data, byteCountToRead,&w2,&h2,&n2, 0);
+		unsigned char* imageData = asset_stream::loadImage(assetManager, path, &w2, &h2, &n2);
+		if (imageData == NULL) {
+			LOGE("Could not decode %s: %s", path, stbi_failure_reason());
+			return false;
+		}
+
+		// n2 is the channel count of the file, the decoded data always has four
+		int format = pixel_convert::formatFromHint(formatHint, n2);
+		LOGI("Size of %s is %ix%i, uploading as %s", path, w2, h2, pixel_convert::formatName(format));
+
+		if (n2 == 2 || n2 == 4) {
+			pixel_convert::premultiply(imageData, w2, h2);
+		}
+
+		unsigned char* pixels = imageData;
+		if (format != PIXEL_RGBA8) {
+			pixels = (unsigned char*) malloc(w2 * h2 * pixel_convert::bytesPerPixel(format));
+			pixel_convert::convert(imageData, w2, h2, format, pixels);
+		}
 
-		LOGI("Size of %s is %ix%i", label, w2,h2);
+		upload_struct upload = {NULL, pixels, w2, h2, 0, 0, 0, 0, format};
+		decoded->upload = upload;
+		decoded->compressed = false;
+		decoded->imageData = imageData;
+		decoded->pixels = pixels;
+		addToCache(key, decoded);
+		return true;
+	}
 
-		glGenTextures(1, &textureID);
+	/* Fills the bound texture with every level of a container; the caller checks glGetError. */
+	static void uploadLevels(const decoded_texture* decoded) {
+		const upload_struct& upload = decoded->upload;
+		GLenum glFormat, type;
+		pixel_convert::glFormat(upload.pixelFormat, &glFormat, &type);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (int level = 0; level < decoded->levels; level++) {
+			int width = upload.width >> level > 0 ? upload.width >> level : 1;
+			int height = upload.height >> level > 0 ? upload.height >> level : 1;
+			glTexImage2D(GL_TEXTURE_2D, level, glFormat, width, height, 0, glFormat, type, decoded->levelData[level]);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, decoded->levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	}
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
+	static void importContainerPage(void* argument) {
+		decoded_texture* decoded = (decoded_texture*) argument;
+		upload_struct& upload = decoded->upload;
 
+		GLuint texture;
+		glGenTextures(1, &texture);
+		gl_state::bindTexture(0, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		while (glGetError() != GL_NO_ERROR) {}
+		uploadLevels(decoded);
+		if (glGetError() != GL_NO_ERROR) {
+			LOGE("Container upload of %s failed", upload.label);
+			gl_state::forgetTexture(texture);
+			glDeleteTextures(1, &texture);
+			upload.page = -1;
+			return;
+		}
+
+		upload.page = texture_atlas::adoptPage(texture, upload.pixelFormat, upload.dataSize, upload.width, upload.height, 0);
+	}
+
+	static bool uploadTexture(const char* label, decoded_texture* decoded) {
+		decoded->upload.label = label;
+
+		if (decoded->container) {
+			render_thread::runSync(importContainerPage, decoded);
+			if (decoded->upload.page < 0) {
+				return false;
+			}
+
+			const float quadRect[4] = {-1.0f, -1.0f, 1.0f, 1.0f};
+			texture_atlas::addEntry(label, decoded->upload.page, 0, 0, decoded->upload.width, decoded->upload.height, quadRect);
+			return true;
+		}
+
+		if (decoded->compressed) {
+			render_thread::runSync(importCompressedPage, &decoded->upload);
+			if (decoded->upload.page < 0) {
+				return false;
+			}
+
+			const float quadRect[4] = {-1.0f, -1.0f, 1.0f, 1.0f};
+			texture_atlas::addEntry(label, decoded->upload.page, 0, 0, decoded->upload.width, decoded->upload.height, quadRect);
+			LOGI("Using compressed %s", label);
+			return true;
+		}
+
+		render_thread::runSync(addToAtlas, &decoded->upload);
+		return true;
+	}
+
+	static void freeDecoded(decoded_texture* decoded) {
+		free(decoded->file);
+		if (decoded->pixels != decoded->imageData) {
+			free(decoded->pixels);
+		}
+		stbi_image_free(decoded->imageData);
+		asset_stream::closeAsset(decoded->asset);
+
+		decoded->file = NULL;
+		decoded->asset = NULL;
+		decoded->imageData = NULL;
+		decoded->pixels = NULL;
+	}
+
+	static bool loadTexture(const char* label, const char* path, const char* formatHint) {
+		decoded_texture decoded;
+		bool loaded = decodeTexture(path, formatHint, true, &decoded) && uploadTexture(label, &decoded);
+		bool prebuilt = decoded.compressed || decoded.container;
+		freeDecoded(&decoded);
+
+		// a .ktx or .cptx the driver refused falls back to the source image
+		if (!loaded && prebuilt) {
+			loaded = decodeTexture(path, formatHint, false, &decoded) && uploadTexture(label, &decoded);
+			freeDecoded(&decoded);
+		}
+		return loaded;
+	}
+
+	struct texture_source {
+		std::string path;
+		std::string formatHint;
+		bool hinted;
+	};
+
+	// everything cacheTexture was told about; uploaded on first use and again after eviction
+	static std::map<std::string, texture_source> textureSources;
+	static int lazyLoads = 0;
+
+	void cacheTexture(char* label, char* path, char* formatHint) {
+		texture_source source;
+		source.path = path;
+		source.hinted = formatHint != NULL;
+		source.formatHint = formatHint != NULL ? formatHint : "";
+		textureSources[label] = source;
+	}
+
+	struct texture_job {
+		std::string label;
+		texture_source source;
+		decoded_texture decoded;
+		bool ready;
+		GLuint texture;
+		GLsync fence;
+		int page;
+		// part of a cacheTextures batch, which reports back itself
+		bool batched;
+	};
+
+	static const double UPLOAD_BUDGET_MILLIS = 4.0;
+
+	// labels with a job on the worker pool or waiting for upload; they draw nothing until loaded
+	static std::set<std::string> loadingTextures;
+	static std::deque<texture_job*> pendingUploads;
+	static std::deque<std::pair<std::string, bool> > finishedTextures;
+
+	// set by anything that can change the screen besides the recorded commands
+	static bool frameDirty = true;
+	static int skippedFrames = 0;
+
+	static double nowMillis() {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+	}
+
+	static void decodeJob(void* argument) {
+		texture_job* job = (texture_job*) argument;
+		const texture_source& source = job->source;
+		job->ready = decodeTexture(source.path.c_str(), source.hinted ? source.formatHint.c_str() : NULL, true, &job->decoded);
+	}
+
+	static bool isResident(const char* label) {
+		GLuint texture;
+		float uvRect[4], quadRect[4];
+		return texture_atlas::lookup(label, &texture, uvRect, quadRect);
+	}
+
+	static void submitJob(const char* label, bool batched) {
+		texture_job* job = new texture_job();
+		job->label = label;
+		job->source = textureSources[label];
+		job->decoded.compressed = false;
+		job->decoded.file = NULL;
+		job->decoded.imageData = NULL;
+		job->decoded.pixels = NULL;
+		job->decoded.container = false;
+		job->decoded.asset = NULL;
+		job->ready = false;
+		job->texture = 0;
+		job->fence = 0;
+		job->page = -1;
+		job->batched = batched;
+
+		loadingTextures.insert(label);
+		worker_pool::submit(decodeJob, job);
+	}
+
+	void cacheTextureAsync(char* label, char* path, char* formatHint) {
+		cacheTexture(label, path, formatHint);
+		if (loadingTextures.count(label) > 0) {
+			return;
+		}
+
+		if (isResident(label)) {
+			finishedTextures.push_back(std::make_pair(std::string(label), true));
+			return;
+		}
+
+		submitJob(label, false);
+	}
+
+	static int frameSharedUploads = 0, lastSharedUploads = 0;
+	static double frameUploadMillis = 0;
+	static float lastUploadMillis = 0;
+
+	// runs on the upload thread's context, which gl_state doesn't shadow
+	static void uploadShared(void* argument) {
+		texture_job* job = (texture_job*) argument;
+		const upload_struct& upload = job->decoded.upload;
+
+		glGenTextures(1, &job->texture);
+		glBindTexture(GL_TEXTURE_2D, job->texture);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
-		glTexImage2D( GL_TEXTURE_2D, 0,	GL_RGBA,	w2, h2, 0, GL_RGBA, GL_UNSIGNED_BYTE,	imageData);
-		stbi_image_free(imageData);
+		while (glGetError() != GL_NO_ERROR) {}
+		if (job->decoded.compressed) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, 0, upload.format, upload.width, upload.height, 0, upload.dataSize, upload.rgba);
+		}
+		else if (job->decoded.container) {
+			uploadLevels(&job->decoded);
+		}
+		else {
+			GLenum glFormat, type;
+			pixel_convert::glFormat(upload.pixelFormat, &glFormat, &type);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexImage2D(GL_TEXTURE_2D, 0, glFormat, upload.width, upload.height, 0, glFormat, type, upload.rgba);
+		}
+
+		if (glGetError() != GL_NO_ERROR) {
+			LOGE("Shared upload of %s failed", job->label.c_str());
+			glDeleteTextures(1, &job->texture);
+			job->texture = 0;
+			return;
+		}
+
+		// the render context waits on this before its first draw with the texture
+		job->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+	}
+
+	static void adoptShared(void* argument) {
+		texture_job* job = (texture_job*) argument;
+		const upload_struct& upload = job->decoded.upload;
+
+		glWaitSync(job->fence, 0, GL_TIMEOUT_IGNORED);
+		glDeleteSync(job->fence);
+		job->fence = 0;
+
+		bool compressed = job->decoded.compressed;
+		long bytes = compressed || job->decoded.container ? upload.dataSize : (long) upload.width * upload.height * pixel_convert::bytesPerPixel(upload.pixelFormat);
+		job->page = texture_atlas::adoptPage(job->texture, compressed ? PIXEL_RGBA8 : upload.pixelFormat, bytes, upload.width, upload.height, 0);
+	}
+
+	static void finishJob(texture_job* job, bool loaded) {
+		freeDecoded(&job->decoded);
+		if (loaded) {
+			frameDirty = true;
+		}
+		else {
+			textureSources.erase(job->label);
+		}
+		loadingTextures.erase(job->label);
+		if (!job->batched) {
+			finishedTextures.push_back(std::make_pair(job->label, loaded));
+		}
+		delete job;
+	}
+
+	static bool uploadJob(texture_job* job) {
+		const texture_source& source = job->source;
+		bool loaded = job->ready && uploadTexture(job->label.c_str(), &job->decoded);
+		bool prebuilt = job->decoded.compressed || job->decoded.container;
+		freeDecoded(&job->decoded);
+		if (!loaded && prebuilt) {
+			loaded = loadTexture(job->label.c_str(), source.path.c_str(), source.hinted ? source.formatHint.c_str() : NULL);
+		}
+
+		finishJob(job, loaded);
+		return loaded;
+	}
+
+	void uploadDecodedTextures() {
+		double start = nowMillis();
+
+		// with a shared context the frame only pays for adopting finished textures
+		void* completed;
+		while (worker_pool::takeCompleted(&completed)) {
+			texture_job* job = (texture_job*) completed;
+			if (job->ready && upload_thread::isRunning()) {
+				upload_thread::submit(uploadShared, job);
+			}
+			else {
+				pendingUploads.push_back(job);
+			}
+		}
+
+		while (upload_thread::takeCompleted(&completed)) {
+			texture_job* job = (texture_job*) completed;
+			if (job->texture == 0) {
+				// retried on the render thread, which also falls back from a refused .ktx
+				pendingUploads.push_back(job);
+				continue;
+			}
+
+			render_thread::runSync(adoptShared, job);
+			const float quadRect[4] = {-1.0f, -1.0f, 1.0f, 1.0f};
+			texture_atlas::addEntry(job->label.c_str(), job->page, 0, 0, job->decoded.upload.width, job->decoded.upload.height, quadRect);
+			frameSharedUploads++;
+			finishJob(job, true);
+		}
+
+		// otherwise at least one upload per frame, however big it is
+		double budgetStart = nowMillis();
+		int uploads = 0;
+		while (!pendingUploads.empty() && (uploads == 0 || nowMillis() - budgetStart < UPLOAD_BUDGET_MILLIS)) {
+			texture_job* job = pendingUploads.front();
+			pendingUploads.pop_front();
 
-		glBindTexture(GL_TEXTURE_2D, 0);
+			uploadJob(job);
+			uploads++;
+		}
+
+		frameUploadMillis += nowMillis() - start;
+	}
+
+	static float lastPreloadMillis = 0;
+
+	/* Decodes a whole batch across the worker pool and uploads every image as it comes in, in whatever order they finish. Returns how many are resident. */
+	int cacheTextures(char** labels, char** paths, char** formatHints, int count) {
+		double start = nowMillis();
+		int outstanding = 0, loaded = 0;
+		for (int i = 0; i < count; i++) {
+			cacheTexture(labels[i], paths[i], formatHints[i]);
+			if (isResident(labels[i])) {
+				loaded++;
+			}
+			// one cacheTextureAsync already started finishes in the background as usual
+			else if (loadingTextures.count(labels[i]) == 0) {
+				submitJob(labels[i], true);
+				outstanding++;
+			}
+		}
+
+		while (outstanding > 0) {
+			void* completed;
+			worker_pool::waitCompleted(&completed);
+			texture_job* job = (texture_job*) completed;
+			if (!job->batched) {
+				pendingUploads.push_back(job);
+				continue;
+			}
+
+			outstanding--;
+			if (uploadJob(job)) {
+				loaded++;
+			}
+		}
+
+		lastPreloadMillis = (float) (nowMillis() - start);
+		LOGI("Cached %i of %i textures on %i workers in %f ms", loaded, count, worker_pool::getWorkerCount(), lastPreloadMillis);
+		return loaded;
+	}
+
+	/* Textures the upload thread filled in a share group that is about to go away are uploaded again later. */
+	static void reclaimSharedUploads() {
+		upload_thread::stop();
+
+		void* completed;
+		while (upload_thread::takeCompleted(&completed)) {
+			texture_job* job = (texture_job*) completed;
+			job->texture = 0;
+			job->fence = 0;
+			pendingUploads.push_back(job);
+		}
+	}
+
+	void markDirty() {
+		frameDirty = true;
+	}
+
+	/* Nothing is loading, so a static screen stays static until the next event. */
+	bool isIdle() {
+		return loadingTextures.empty() && pendingUploads.empty() && finishedTextures.empty();
+	}
+
+	bool takeFinishedTexture(char* label, int size, bool* loaded) {
+		if (finishedTextures.empty()) {
+			return false;
+		}
+
+		snprintf(label, size, "%s", finishedTextures.front().first.c_str());
+		*loaded = finishedTextures.front().second;
+		finishedTextures.pop_front();
+		return true;
+	}
+
+	static void discardTextureJobs() {
+		void* completed;
+		while (worker_pool::takeCompleted(&completed)) {
+			pendingUploads.push_back((texture_job*) completed);
+		}
+
+		for (size_t i = 0; i < pendingUploads.size(); i++) {
+			freeDecoded(&pendingUploads[i]->decoded);
+			delete pendingUploads[i];
+		}
+		pendingUploads.clear();
+		loadingTextures.clear();
+	}
+
+	static bool lookupResident(const char* label, sprite_struct* sprite) {
+		if (texture_atlas::lookup(label, &sprite->texture, sprite->uvRect, sprite->quadRect)) {
+			return true;
+		}
+
+		std::map<std::string, texture_source>::iterator source = textureSources.find(label);
+		if (source == textureSources.end() || loadingTextures.count(label) > 0) {
+			return false;
+		}
+
+		lazyLoads++;
+		if (!loadTexture(label, source->second.path.c_str(), source->second.hinted ? source->second.formatHint.c_str() : NULL)) {
+			// don't retry a broken file every frame
+			textureSources.erase(source);
+			return false;
+		}
+		frameDirty = true;
+		return texture_atlas::lookup(label, &sprite->texture, sprite->uvRect, sprite->quadRect);
+	}
+
+	static void setBudget(void* argument) {
+		texture_atlas::setBudget(*(int*) argument);
+	}
 
+	void setTextureBudget(int kilobytes) {
+		render_thread::runSync(setBudget, &kilobytes);
+	}
+
+	struct index_reader {
+		const unsigned char* data;
+		int size, position;
+		bool failed;
+	};
+
+	static int readU8(index_reader* reader) {
+		if (reader->position + 1 > reader->size) {
+			reader->failed = true;
+			return 0;
+		}
+		return reader->data[reader->position++];
+	}
 
-		textureCache[label]  = textureID;		
+	static int readU16(index_reader* reader) {
+		int low = readU8(reader);
+		return low | (readU8(reader) << 8);
+	}
+
+	static std::string readString(index_reader* reader) {
+		int length = readU8(reader);
+		if (reader->position + length > reader->size) {
+			reader->failed = true;
+			return std::string();
+		}
+		std::string result((const char*) reader->data + reader->position, length);
+		reader->position += length;
+		return result;
+	}
+
+	// cooked atlases already in the current context, cacheTexturesInit runs again on every new window
+	static std::set<std::string> loadedAtlases;
+
+	bool loadAtlas(char* indexPath) {
+		if (loadedAtlases.count(indexPath) > 0) {
+			return true;
+		}
+
+		unsigned char* data;
+		int size = readBinaryFile(assetManager, indexPath, &data);
+		if (size < 0) {
+			LOGI("No atlas at %s", indexPath);
+			return false;
+		}
+		if (size < 8 || memcmp(data, atlas_format::MAGIC, 4) != 0) {
+			LOGE("%s is not an atlas index", indexPath);
+			free(data);
+			return false;
+		}
+
+		index_reader reader = {data, size, 4, false};
+		if (readU16(&reader) != atlas_format::VERSION) {
+			LOGE("%s has unsupported version", indexPath);
+			free(data);
+			return false;
+		}
+
+		int pageCount = readU16(&reader);
+		std::vector<int> pageIndices;
+		for (int i = 0; i < pageCount && !reader.failed; i++) {
+			std::string pagePath = readString(&reader);
+			int pageWidth = readU16(&reader);
+			readU16(&reader);
+
+			int compressedPage = loadCompressed(pagePath.c_str(), atlas_format::PADDING, pageWidth);
+			if (compressedPage >= 0) {
+				texture_atlas::pinPage(compressedPage);
+				pageIndices.push_back(compressedPage);
+				continue;
+			}
+
+			int w2,h2,n2;
+			unsigned char* imageData = asset_stream::loadImage(assetManager, pagePath.c_str(), &w2, &h2, &n2);
+			if (imageData == NULL || w2 != pageWidth || h2 != pageWidth) {
+				LOGE("Could not load atlas page %s", pagePath.c_str());
+				reader.failed = true;
+			}
+			else {
+				pixel_convert::premultiply(imageData, w2, h2);
+				upload_struct upload = {NULL, imageData, w2, h2, 0};
+				render_thread::runSync(importAtlasPage, &upload);
+				pageIndices.push_back(upload.page);
+			}
+			stbi_image_free(imageData);
+		}
+
+		int entryCount = readU16(&reader);
+		for (int i = 0; i < entryCount && !reader.failed; i++) {
+			std::string label = readString(&reader);
+			int page = readU16(&reader);
+			int x = readU16(&reader), y = readU16(&reader);
+			int width = readU16(&reader), height = readU16(&reader);
+			int sourceWidth = readU16(&reader), sourceHeight = readU16(&reader);
+			int trimX = readU16(&reader), trimY = readU16(&reader);
+			if (reader.failed || page >= (int) pageIndices.size()) {
+				reader.failed = true;
+				break;
+			}
+
+			// the untrimmed image covers -1..1, image rows run top to bottom
+			float quadRect[4] = {
+				-1.0f + 2.0f * trimX / sourceWidth,
+				1.0f - 2.0f * (trimY + height) / sourceHeight,
+				-1.0f + 2.0f * (trimX + width) / sourceWidth,
+				1.0f - 2.0f * trimY / sourceHeight
+			};
+			texture_atlas::addEntry(label.c_str(), pageIndices[page], x, y, width, height, quadRect);
+		}
+
+		free(data);
+
+		if (reader.failed) {
+			LOGE("%s is truncated or broken", indexPath);
+			return false;
+		}
+
+		LOGI("Loaded atlas %s: %i pages, %i entries", indexPath, pageCount, entryCount);
+		loadedAtlases.insert(indexPath);
+		return true;
 	}
 
 	static EGLint w, h;
+	static EGLConfig config;
 
-	int init(global_struct* global) {
-		// initialize OpenGL ES and EGL
-		ANativeWindow* window = global->native_stuff.window;
+	// set when initOnRenderThread had to build a new context, so textures start over
+	static bool contextCreated = false;
+	// eglSwapInterval belongs to the surface, so a new surface starts unset
+	static int appliedSwapInterval = 0;
 
+	static void createContext() {
 		/*
 		 * Here specify the attributes of the desired configuration.
 		 * Below, we select an EGLConfig with at least 8 bits per color
-		 * component compatible with on-screen windows
+		 * component compatible with on-screen windows. ES3 is asked for
+		 * first, ES2 is the fallback.
 		 */
-		const EGLint attribs[] = {
+		const EGLint attribsES3[] = {
+				EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,
+				EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+				EGL_BLUE_SIZE, 8,
+				EGL_GREEN_SIZE, 8,
+				EGL_RED_SIZE, 8,
+				EGL_NONE
+		};
+		const EGLint attribsES2[] = {
+				EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
 				EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
 				EGL_BLUE_SIZE, 8,
 				EGL_GREEN_SIZE, 8,
 				EGL_RED_SIZE, 8,
 				EGL_NONE
 		};
-		EGLint dummy, format;
-		EGLint numConfigs;
-		EGLConfig config;
+		const EGLint contextES3[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+		const EGLint contextES2[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+
+		EGLint numConfigs = 0;
 
 		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
 
@@ -217,7 +1129,23 @@ namespace opengl_wrapper {
 		/* Here, the application chooses the configuration it desires. In this
 		 * sample, we have a very simplified selection process, where we pick
 		 * the first EGLConfig that matches our criteria */
-		eglChooseConfig(display, attribs, &config, 1, &numConfigs);
+		context = EGL_NO_CONTEXT;
+		if (eglChooseConfig(display, attribsES3, &config, 1, &numConfigs) && numConfigs > 0) {
+			context = eglCreateContext(display, config, NULL, contextES3);
+		}
+		isES3 = context != EGL_NO_CONTEXT;
+		if (!isES3) {
+			eglChooseConfig(display, attribsES2, &config, 1, &numConfigs);
+			context = eglCreateContext(display, config, NULL, contextES2);
+		}
+		LOGI("Created GLES %i context", isES3 ? 3 : 2);
+
+		damage_region::init(display);
+	}
+
+	/* Creates a surface for the window and makes the context current on it, returns the EGL error if that fails. */
+	static EGLint attachWindow(ANativeWindow* window) {
+		EGLint format;
 
 		/* EGL_NATIVE_VISUAL_ID is an attribute of the EGLConfig that is
 		 * guaranteed to be accepted by ANativeWindow_setBuffersGeometry().
@@ -228,15 +1156,14 @@ namespace opengl_wrapper {
 		ANativeWindow_setBuffersGeometry(window, 0, 0, format);
 
 		surface = eglCreateWindowSurface(display, config, window, NULL);
-		int* attrib_list1 = new int[3];
-		attrib_list1[0]=EGL_CONTEXT_CLIENT_VERSION;
-		attrib_list1[1]=2;
-		attrib_list1[2]=EGL_NONE;
-		context = eglCreateContext(display, config, NULL, attrib_list1);
+		appliedSwapInterval = 0;
 
 		if (eglMakeCurrent(display, surface, surface, context) == EGL_FALSE) {
 			// LOGW("Unable to eglMakeCurrent");
-			return -1;
+			EGLint error = eglGetError();
+			eglDestroySurface(display, surface);
+			surface = EGL_NO_SURFACE;
+			return error;
 		}
 
 		eglQuerySurface(display, surface, EGL_WIDTH, &w);
@@ -248,26 +1175,138 @@ namespace opengl_wrapper {
 			h = w;
 			w = temp;
 		}
-		glViewport(0,0,w,h);
+		gl_state::viewport(0,0,w,h);
 		LOGI("Dimenions %ix%i", w, h);
 		mProjMatrix = glm::perspective(45.0f, w*1.0f/h, 0.1f, 100.0f);
 
+		return EGL_SUCCESS;
+	}
+
+	static void initContextState() {
+		gl_state::reset();
+		stream_buffer::init(isES3);
+		texture_atlas::init(isES3);
+
 		// glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_FASTEST);
 		// glEnable(GL_CULL_FACE);
 		// glShadeModel(GL_SMOOTH);
 		glDisable(GL_DEPTH_TEST);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		// every texture is premultiplied, additive sprites just carry zero alpha
+		gl_state::setBlend(true);
+		gl_state::blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	}
+
+	static void destroyOnRenderThread(void*);
+
+	static void initOnRenderThread(void* argument) {
+		// initialize OpenGL ES and EGL
+		ANativeWindow* window = (ANativeWindow*) argument;
+		contextCreated = false;
+
+		// a context kept from the last window only needs a new surface
+		if (context != EGL_NO_CONTEXT) {
+			EGLint error = attachWindow(window);
+			if (error == EGL_SUCCESS) {
+				LOGI("Kept the GLES %i context", isES3 ? 3 : 2);
+				return;
+			}
+			if (error != EGL_CONTEXT_LOST) {
+				LOGE("Could not attach the window: 0x%x", error);
+				return;
+			}
+			LOGI("Context lost, starting over");
+			destroyOnRenderThread(NULL);
+		}
+
+		createContext();
+		if (attachWindow(window) != EGL_SUCCESS) {
+			return;
+		}
+		initContextState();
+		contextCreated = true;
+	}
 
+	static void drawFrame(int);
+	static void updateViewBounds();
 
+	int init(global_struct* global) {
 		readBinaryFile = global->native_stuff.readBinaryFile;
 		assetManager = global->native_stuff.assetManager;
+		program_cache::init(global->native_stuff.activity != NULL ? global->native_stuff.activity->internalDataPath : NULL);
+
+		render_thread::start(drawFrame);
+		worker_pool::start();
+		render_thread::runSync(initOnRenderThread, global->native_stuff.window);
+		if (surface == EGL_NO_SURFACE) {
+			return -1;
+		}
+
+		// uploads made for a context that was lost have to be made again
+		if (contextCreated) {
+			reclaimSharedUploads();
+		}
+		// glFenceSync and glWaitSync need ES3
+		if (isES3) {
+			upload_thread::start(display, context);
+		}
 
+		render_queue::setMatrices(glm::value_ptr(mProjMatrix), glm::value_ptr(viewMatrix));
+		updateViewBounds();
 		return 0;
 	}
 
+	static double resizeStartMillis = 0;
+	static float lastResizeMillis = 0;
+
+	static void resizeOnRenderThread(void* argument) {
+		resizeStartMillis = nowMillis();
+
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroySurface(display, surface);
+		surface = EGL_NO_SURFACE;
+
+		EGLint error = attachWindow((ANativeWindow*) argument);
+		if (error != EGL_SUCCESS) {
+			LOGE("Could not recreate the surface: 0x%x", error);
+		}
+	}
+
+	/* 0 when only the surface was rebuilt, 1 when the context had to be created again, -1 on failure. */
+	int resize(global_struct* global) {
+		if (surface != EGL_NO_SURFACE) {
+			render_thread::runSync(resizeOnRenderThread, global->native_stuff.window);
+		}
+		if (surface == EGL_NO_SURFACE) {
+			// lost the context on the way, go through the full path
+			if (init(global) != 0) {
+				return -1;
+			}
+			return contextCreated ? 1 : 0;
+		}
+
+		render_queue::setMatrices(glm::value_ptr(mProjMatrix), glm::value_ptr(viewMatrix));
+		updateViewBounds();
+		return 0;
+	}
+
+	static void releaseWindowOnRenderThread(void*) {
+		if (surface != EGL_NO_SURFACE) {
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			eglDestroySurface(display, surface);
+			surface = EGL_NO_SURFACE;
+		}
+	}
+
+	void releaseWindow() {
+		// the window may go away as soon as this returns, the context stays
+		render_thread::runSync(releaseWindowOnRenderThread, NULL);
+	}
+
+	static void destroyOnRenderThread(void*) {
+		sprite_batch::destroy();
+		stream_buffer::destroy();
+		texture_atlas::destroy();
 
-	void destroy() {
 		if (display != EGL_NO_DISPLAY) {
 			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
 			if (context != EGL_NO_CONTEXT) {
@@ -279,51 +1318,163 @@ namespace opengl_wrapper {
 			eglTerminate(display);
 		}
 
+		gl_state::reset();
+		mProgram = 0;
+		loadedAtlases.clear();
+
 		display = EGL_NO_DISPLAY;
 		context = EGL_NO_CONTEXT;
 		surface = EGL_NO_SURFACE;
 	}
 
+	void destroy() {
+		reclaimSharedUploads();
 
-	static GLuint mProgram;
-
-	static const GLfloat gTriangleVertices[] = { -1.0f,-1.0f, 1.0f,-1.0f, -1.0f,1.0f, 1.0f,1.0f };
+		// the window may go away as soon as this returns
+		render_thread::runSync(destroyOnRenderThread, NULL);
+	}
 
-	static const GLfloat gTextureUVcoords[] = { 0.0f,1.0f, 1.0f,1.0f, 0.0f,0.0f, 1.0f,0.0f };
+	void shutdown() {
+		worker_pool::stop();
+		reclaimSharedUploads();
+		discardTextureJobs();
+		render_thread::stop();
 
-	void initProgramSimplest() {
-		mProgram = createProgram(VERTEX_SHADER, FRAGMENT_SHADER);
+		pthread_mutex_lock(&cpuCacheMutex);
+		cpuCache.clear();
+		cpuCacheBytes = 0;
+		pthread_mutex_unlock(&cpuCacheMutex);
 	}
 
-	void initProgram() {
-		mProgram = createProgram(VERTEX_SHADER_WITH_TEXTURE, FRAGMENT_SHADER_WITH_TEXTURE);
+	/* Program binaries need GLES 3.0, ES2 always compiles. */
+	static GLuint createProgramCached(const char* vertex, const char* fragment) {
+		if (!isES3) {
+			return createProgram(vertex, fragment);
+		}
+
+		GLuint program = program_cache::load(vertex, fragment);
+		if (program != 0) {
+			return program;
+		}
+
+		program = createProgram(vertex, fragment, true);
+		program_cache::store(program, vertex, fragment);
+		return program;
 	}
 
-	void renderSimplest(float color) {
-		glClearColor(1.0-color, 1.0-color, color, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT);
+	static void initProgramOnRenderThread(void*) {
+		// still there if the context survived the last window
+		if (mProgram != 0) {
+			return;
+		}
+
+		double start = nowMillis();
 
+		bool instanced = false;
+		if (isES3) {
+			mProgram = createProgramCached(VERTEX_SHADER_INSTANCED, FRAGMENT_SHADER_INSTANCED);
+			instanced = mProgram != 0;
+		}
+		if (!instanced) {
+			mProgram = createProgramCached(VERTEX_SHADER_WITH_TEXTURE, FRAGMENT_SHADER_WITH_TEXTURE);
+		}
 
-		glUseProgram(mProgram);
+		LOGI("Programs ready in %.2f ms", nowMillis() - start);
 
-		int aPositionHandle = glGetAttribLocation(mProgram, "a_Position");
-		glVertexAttribPointer(aPositionHandle, 2, GL_FLOAT, GL_FALSE, 0, gTriangleVertices);
-		glEnableVertexAttribArray(aPositionHandle);
+		sprite_batch::init(mProgram, instanced);
+	}
 
-		glDrawArrays(GL_TRIANGLES, 0, 3);
+	void initProgram() {
+		render_thread::runSync(initProgramOnRenderThread, NULL);
 	}
 
 	void clearScreen(float colorR, float colorG, float colorB) {
-		glClearColor(colorR, colorG, colorB, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT);
+		render_queue::clear(colorR, colorG, colorB);
 	}
 
-	static glm::mat4 viewMatrix = glm::lookAt(glm::vec3(0,0,0), glm::vec3(0,0,0), glm::vec3(0,1,0));
-	static glm::mat4 unprojectViewMatrix = glm::lookAt(glm::vec3(0,0,0), glm::vec3(0,0,0), glm::vec3(0,1,0));
+	// footprint of the view frustum on the z=0 plane and how each bound moves
+	// per unit of z, so sprites off the plane are tested against their own slice
+	static float viewBounds[4];
+	static float viewBoundsSlope[4];
+	static bool viewBoundsValid = false;
+
+	static int frameVisible = 0, frameCulled = 0;
+	static int lastVisible = 0, lastCulled = 0;
+
+	static double lastSwapMillis = 0;
+	static float lastFrameMillis = 0;
+
+	static void updateViewBounds() {
+		glm::mat4x4 inverse = glm::inverse(mProjMatrix * viewMatrix);
+
+		float planes[2][4];
+		for (int plane = 0; plane < 2; plane++) {
+			planes[plane][0] = planes[plane][1] = FLT_MAX;
+			planes[plane][2] = planes[plane][3] = -FLT_MAX;
+		}
+
+		for (int corner = 0; corner < 4; corner++) {
+			float ndcX = (corner & 1) ? 1.0f : -1.0f;
+			float ndcY = (corner & 2) ? 1.0f : -1.0f;
+			glm::vec4 nearPoint = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+			glm::vec4 farPoint = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+			glm::vec3 from = glm::vec3(nearPoint) / nearPoint.w;
+			glm::vec3 to = glm::vec3(farPoint) / farPoint.w;
+
+			for (int plane = 0; plane < 2; plane++) {
+				float t = (plane - from.z) / (to.z - from.z);
+				float x = from.x + (to.x - from.x) * t;
+				float y = from.y + (to.y - from.y) * t;
+				planes[plane][0] = x < planes[plane][0] ? x : planes[plane][0];
+				planes[plane][1] = y < planes[plane][1] ? y : planes[plane][1];
+				planes[plane][2] = x > planes[plane][2] ? x : planes[plane][2];
+				planes[plane][3] = y > planes[plane][3] ? y : planes[plane][3];
+			}
+		}
+
+		for (int i = 0; i < 4; i++) {
+			viewBounds[i] = planes[0][i];
+			viewBoundsSlope[i] = planes[1][i] - planes[0][i];
+		}
+		viewBoundsValid = true;
+	}
+
+	static bool isVisible(const sprite_struct& sprite) {
+		if (!viewBoundsValid) {
+			return true;
+		}
+
+		// a negative scale mirrors a trimmed quad onto the other side of the origin
+		const float* quad = sprite.quadRect;
+		float left = quad[0] * sprite.scale, right = quad[2] * sprite.scale;
+		float bottom = quad[1] * sprite.scale, top = quad[3] * sprite.scale;
+		float minX = left < right ? left : right;
+		float maxX = left < right ? right : left;
+		float minY = bottom < top ? bottom : top;
+		float maxY = bottom < top ? top : bottom;
+
+		if (sprite.rotation != 0.0f) {
+			// any rotation stays inside the circle through the farthest corner
+			float farX = fabsf(minX) > fabsf(maxX) ? minX : maxX;
+			float farY = fabsf(minY) > fabsf(maxY) ? minY : maxY;
+			float radius = sqrtf(farX * farX + farY * farY);
+			minX = minY = -radius;
+			maxX = maxY = radius;
+		}
+
+		float z = sprite.z;
+		return sprite.x + maxX >= viewBounds[0] + viewBoundsSlope[0] * z
+			&& sprite.y + maxY >= viewBounds[1] + viewBoundsSlope[1] * z
+			&& sprite.x + minX <= viewBounds[2] + viewBoundsSlope[2] * z
+			&& sprite.y + minY <= viewBounds[3] + viewBoundsSlope[3] * z;
+	}
 
 	void setCamera(float offsetX, float offsetY, float offsetZ) {
 		viewMatrix = glm::lookAt(glm::vec3(offsetX,offsetY,offsetZ), glm::vec3(offsetX,offsetY,0), glm::vec3(0,1,0));
 		unprojectViewMatrix = glm::lookAt(glm::vec3(offsetX,-offsetY,offsetZ), glm::vec3(offsetX,-offsetY,0), glm::vec3(0,1,0));
+
+		render_queue::setMatrices(glm::value_ptr(mProjMatrix), glm::value_ptr(viewMatrix));
+		updateViewBounds();
 	}
 
 	void getScreenDimensions(int* width, int* height) {
@@ -360,36 +1511,159 @@ namespace opengl_wrapper {
 		*worldY = -(nearArr[1] + (farArr[1] - nearArr[1]) * t);
 	}
 
-	void render(char* textureLabel, float offsetX, float offsetY, float offsetZ) {
-		glm::mat4 modelMatrix = glm::translate(glm::mat4(), glm::vec3(offsetX, offsetY, offsetZ));
-		glm::mat4 mModelViewMatrix = viewMatrix * modelMatrix;
+	static int currentLayer = 0;
+	static int currentBlend = BLEND_ALPHA;
 
-		glUseProgram(mProgram);
+	void setLayer(int layer) {
+		currentLayer = layer;
+	}
 
-		int uProjection = glGetUniformLocation(mProgram, "u_Projection");
-		glUniformMatrix4fv(uProjection, 1, false, glm::value_ptr(mProjMatrix));
+	void setLayerSorted(int layer, bool sorted) {
+		render_queue::setLayerSorted(layer, sorted);
+	}
 
-		int uModelView = glGetUniformLocation(mProgram, "u_ModelView");
-		glUniformMatrix4fv(uModelView, 1, false, glm::value_ptr(mModelViewMatrix));
+	void setBlendMode(int blend) {
+		currentBlend = blend;
+	}
 
+	void render(char* textureLabel, float offsetX, float offsetY, float offsetZ, float rotation, float scale) {
+		sprite_struct sprite;
+		if (lookupResident(textureLabel, &sprite)) {
+			sprite.x = offsetX;
+			sprite.y = offsetY;
+			sprite.z = offsetZ;
+			sprite.rotation = rotation;
+			sprite.scale = scale;
+			sprite.tint = currentBlend == BLEND_ADDITIVE ? 0x00FFFFFF : 0xFFFFFFFF;
+
+			if (isVisible(sprite)) {
+				render_queue::submit(sprite, currentLayer);
+				frameVisible++;
+			}
+			else {
+				frameCulled++;
+			}
+		}
+	}
 
-		int gvPositionHandle = glGetAttribLocation(mProgram, "a_Position");
-		glVertexAttribPointer(gvPositionHandle, 2, GL_FLOAT, GL_FALSE, 0, gTriangleVertices);
-		glEnableVertexAttribArray(gvPositionHandle);
+	struct render_stats_struct {
+		int sprites, drawCalls, glIssued, glElided, atlasPages, commands, fenceWaits;
+		int atlasKilobytes, residentTextures, evictions, budgetKilobytes;
+		int redrawnPixels;
+		float resizeMillis;
+		float cpuMillis, atlasFill, sortMicros, fenceWaitMillis;
+	};
+
+	// written by the render thread after every frame, read from the logic thread
+	static pthread_mutex_t statsMutex = PTHREAD_MUTEX_INITIALIZER;
+	static render_stats_struct renderStats;
+
+	static void updateRenderStats() {
+		render_stats_struct stats;
+		sprite_batch::getStats(&stats.sprites, &stats.drawCalls, &stats.cpuMillis);
+		gl_state::getStats(&stats.glIssued, &stats.glElided);
+		texture_atlas::getStats(&stats.atlasPages, &stats.atlasFill, &stats.atlasKilobytes);
+		texture_atlas::getResidency(&stats.residentTextures, &stats.evictions, &stats.budgetKilobytes);
+		render_queue::getStats(&stats.commands, &stats.sortMicros);
+		stream_buffer::getStats(&stats.fenceWaits, &stats.fenceWaitMillis);
+		stats.resizeMillis = lastResizeMillis;
+		damage_region::getStats(&stats.redrawnPixels);
+
+		pthread_mutex_lock(&statsMutex);
+		renderStats = stats;
+		pthread_mutex_unlock(&statsMutex);
+	}
 
-		int aUVHandle = glGetAttribLocation(mProgram, "a_TextureUV");
-		glVertexAttribPointer(aUVHandle, 2, GL_FLOAT, GL_FALSE, 0, gTextureUVcoords);
-		glEnableVertexAttribArray(aUVHandle);
+	void getRenderStats(char* result, int size) {
+		pthread_mutex_lock(&statsMutex);
+		render_stats_struct stats = renderStats;
+		pthread_mutex_unlock(&statsMutex);
+
+		pthread_mutex_lock(&cpuCacheMutex);
+		int cpuCacheKilobytes = (int) (cpuCacheBytes / 1024);
+		pthread_mutex_unlock(&cpuCacheMutex);
+
+		float frameDelta, presentMillis;
+		int missedFrames;
+		frame_scheduler::getStats(&frameDelta, &presentMillis, &missedFrames);
+
+		snprintf(result, size, "{\"sprites\": %i, \"drawCalls\": %i, \"batchMillis\": %f, \"glIssued\": %i, \"glElided\": %i, "
+			"\"atlasPages\": %i, \"atlasFill\": %f, \"atlasKilobytes\": %i, \"commands\": %i, \"sortMicros\": %f, \"visible\": %i, \"culled\": %i, "
+			"\"fenceWaits\": %i, \"fenceWaitMillis\": %f, \"residentTextures\": %i, \"registeredTextures\": %i, "
+			"\"evictions\": %i, \"lazyLoads\": %i, \"budgetKilobytes\": %i, \"frameMillis\": %f, \"uploadMillis\": %f, "
+			"\"sharedUploads\": %i, \"resizeMillis\": %f, \"cpuCacheKilobytes\": %i, "
+			"\"frameDelta\": %f, \"presentMillis\": %f, \"swapInterval\": %i, \"missedFrames\": %i, \"skippedFrames\": %i, \"redrawnPixels\": %i, "
+			"\"preloadMillis\": %f, \"workers\": %i}",
+			stats.sprites, stats.drawCalls, stats.cpuMillis, stats.glIssued, stats.glElided,
+			stats.atlasPages, stats.atlasFill, stats.atlasKilobytes, stats.commands, stats.sortMicros, lastVisible, lastCulled,
+			stats.fenceWaits, stats.fenceWaitMillis, stats.residentTextures, (int) textureSources.size(),
+			stats.evictions, lazyLoads, stats.budgetKilobytes, lastFrameMillis, lastUploadMillis,
+			lastSharedUploads, stats.resizeMillis, cpuCacheKilobytes,
+			frameDelta, presentMillis, frame_scheduler::getSwapInterval(), missedFrames, skippedFrames, stats.redrawnPixels,
+			lastPreloadMillis, worker_pool::getWorkerCount());
+	}
+
+	static void drawFrame(int slot) {
+		// frames published between TERM_WINDOW and the next INIT_WINDOW are dropped
+		if (surface == EGL_NO_SURFACE) {
+			return;
+		}
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, textureCache[textureLabel]);
+		double start = nowMillis();
 
-		GLubyte indices[] = {3,0,1, 3,2,0};
-		glDrawElements(GL_TRIANGLES, sizeof(indices), GL_UNSIGNED_BYTE, indices);
+		damage_region::beginFrame(display, surface, w, h);
+		render_queue::execute(slot);
+
+		render_queue::endFrame();
+		sprite_batch::endFrame();
+		stream_buffer::endFrame();
+		gl_state::endFrame();
+
+		// 30 fps and adaptive pacing swap every other vsync
+		int swapInterval = frame_scheduler::getSwapInterval();
+		if (swapInterval != appliedSwapInterval) {
+			eglSwapInterval(display, swapInterval);
+			appliedSwapInterval = swapInterval;
+		}
+
+		double renderMillis = nowMillis() - start;
+		damage_region::swap(display, surface);
+		frame_scheduler::framePresented(renderMillis);
+
+		// rotation to first frame, the surface was rebuilt by resizeOnRenderThread
+		if (resizeStartMillis > 0) {
+			lastResizeMillis = (float) (nowMillis() - resizeStartMillis);
+			resizeStartMillis = 0;
+		}
+
+		texture_atlas::releaseRetired();
+		updateRenderStats();
 	}
 
-	void swapBuffers() {
-		eglSwapBuffers(display, surface);
+	bool swapBuffers() {
+		lastVisible = frameVisible;
+		lastCulled = frameCulled;
+		frameVisible = 0;
+		frameCulled = 0;
+
+		// logic thread frame time, which texture uploads shouldn't show up in
+		double now = nowMillis();
+		lastFrameMillis = lastSwapMillis > 0 ? (float) (now - lastSwapMillis) : 0.0f;
+		lastSwapMillis = now;
+		lastUploadMillis = (float) frameUploadMillis;
+		lastSharedUploads = frameSharedUploads;
+		frameUploadMillis = 0;
+		frameSharedUploads = 0;
+
+		texture_atlas::nextFrame();
+
+		// a frame identical to the one on screen is neither drawn nor swapped
+		bool published = render_queue::publish(frameDirty);
+		frameDirty = false;
+		if (!published) {
+			skippedFrames++;
+		}
+		return published;
 	}
 
 }
\ No newline at end of file
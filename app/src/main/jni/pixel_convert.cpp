@@ -0,0 +1,316 @@
+#include <string.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PIXEL_CONVERT_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PIXEL_CONVERT_SSE2
+#endif
+
+#include <engine/pixel_convert.h>
+
+/**
+ * Turns decoded RGBA8 rows into the smaller upload formats. The 16-bit
+ * formats are ordered-dithered with a 4x4 Bayer matrix so gradients don't
+ * band. NEON kernels run 16 pixels at a time. On SSE2 premultiply runs 4
+ * and the 16-bit packers 8, while RGB8, L8 and LA8 stay scalar. Every
+ * kernel finishes the row with the scalar code, which is also the
+ * reference the SIMD paths have to match bit for bit.
+ *
+ * Textures are premultiplied before conversion, c * a / 255 rounded to
+ * nearest, so the 16-bit formats dither the premultiplied values.
+ */
+namespace pixel_convert {
+
+	static const unsigned char BAYER[4][4] = {
+		{0, 8, 2, 10},
+		{12, 4, 14, 6},
+		{3, 11, 1, 9},
+		{15, 7, 13, 5}
+	};
+
+	static inline unsigned char addSaturated(int value, int dither) {
+		value += dither;
+		return (unsigned char) (value > 255 ? 255 : value);
+	}
+
+	int formatFromHint(const char* hint, int channels) {
+		if (hint != NULL) {
+			if (strcmp(hint, "rgba8") == 0) return PIXEL_RGBA8;
+			if (strcmp(hint, "rgb8") == 0) return PIXEL_RGB8;
+			if (strcmp(hint, "rgb565") == 0) return PIXEL_RGB565;
+			if (strcmp(hint, "rgba4444") == 0) return PIXEL_RGBA4444;
+			if (strcmp(hint, "l8") == 0) return PIXEL_L8;
+			if (strcmp(hint, "la8") == 0) return PIXEL_LA8;
+		}
+
+		switch (channels) {
+			case 1: return PIXEL_L8;
+			case 2: return PIXEL_LA8;
+			case 3: return PIXEL_RGB8;
+			default: return PIXEL_RGBA8;
+		}
+	}
+
+	const char* formatName(int format) {
+		static const char* names[] = {"rgba8", "rgb8", "rgb565", "rgba4444", "l8", "la8"};
+		return names[format];
+	}
+
+	int bytesPerPixel(int format) {
+		static const int sizes[] = {4, 3, 2, 2, 1, 2};
+		return sizes[format];
+	}
+
+	void glFormat(int format, GLenum* glFormat, GLenum* type) {
+		switch (format) {
+			case PIXEL_RGB8: *glFormat = GL_RGB; *type = GL_UNSIGNED_BYTE; break;
+			case PIXEL_RGB565: *glFormat = GL_RGB; *type = GL_UNSIGNED_SHORT_5_6_5; break;
+			case PIXEL_RGBA4444: *glFormat = GL_RGBA; *type = GL_UNSIGNED_SHORT_4_4_4_4; break;
+			case PIXEL_L8: *glFormat = GL_LUMINANCE; *type = GL_UNSIGNED_BYTE; break;
+			case PIXEL_LA8: *glFormat = GL_LUMINANCE_ALPHA; *type = GL_UNSIGNED_BYTE; break;
+			default: *glFormat = GL_RGBA; *type = GL_UNSIGNED_BYTE; break;
+		}
+	}
+
+	// ES2 only guarantees the 16-bit formats as render targets, 8-bit RGB and
+	// RGBA need ES3 or OES_rgb8_rgba8, luminance never is one
+	bool isRenderable(int format, bool eightBitRenderable) {
+		switch (format) {
+			case PIXEL_RGB565: return true;
+			case PIXEL_RGBA4444: return true;
+			case PIXEL_RGBA8: return eightBitRenderable;
+			case PIXEL_RGB8: return eightBitRenderable;
+			default: return false;
+		}
+	}
+
+	// exact round(value * alpha / 255) for 8-bit inputs
+	static inline unsigned char multiply(int value, int alpha) {
+		int product = value * alpha + 128;
+		return (unsigned char) ((product + (product >> 8)) >> 8);
+	}
+
+	void premultiply(unsigned char* rgba, int width, int height) {
+		int count = width * height;
+		int i = 0;
+#ifdef PIXEL_CONVERT_NEON
+		for (; i + 16 <= count; i += 16) {
+			uint8x16x4_t pixels = vld4q_u8(rgba + i * 4);
+			uint8x16_t alpha = pixels.val[3];
+			for (int channel = 0; channel < 3; channel++) {
+				// product + round(product / 256), then rounded down by 8 bits: same as multiply()
+				uint16x8_t low = vmull_u8(vget_low_u8(pixels.val[channel]), vget_low_u8(alpha));
+				uint16x8_t high = vmull_u8(vget_high_u8(pixels.val[channel]), vget_high_u8(alpha));
+				low = vrsraq_n_u16(low, low, 8);
+				high = vrsraq_n_u16(high, high, 8);
+				pixels.val[channel] = vcombine_u8(vrshrn_n_u16(low, 8), vrshrn_n_u16(high, 8));
+			}
+			vst4q_u8(rgba + i * 4, pixels);
+		}
+#elif defined(PIXEL_CONVERT_SSE2)
+		__m128i zero = _mm_setzero_si128();
+		__m128i rounding = _mm_set1_epi16(128);
+		// the alpha lane is multiplied by 255, which leaves it unchanged
+		__m128i alphaLane = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+		__m128i colorLanes = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+
+		for (; i + 4 <= count; i += 4) {
+			__m128i pixels = _mm_loadu_si128((const __m128i*) (rgba + i * 4));
+			__m128i halves[2] = {_mm_unpacklo_epi8(pixels, zero), _mm_unpackhi_epi8(pixels, zero)};
+			for (int half = 0; half < 2; half++) {
+				__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(halves[half], 0xFF), 0xFF);
+				alpha = _mm_or_si128(_mm_and_si128(alpha, colorLanes), alphaLane);
+				__m128i product = _mm_add_epi16(_mm_mullo_epi16(halves[half], alpha), rounding);
+				halves[half] = _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+			}
+			_mm_storeu_si128((__m128i*) (rgba + i * 4), _mm_packus_epi16(halves[0], halves[1]));
+		}
+#endif
+		for (; i < count; i++) {
+			unsigned char* pixel = rgba + i * 4;
+			int alpha = pixel[3];
+			pixel[0] = multiply(pixel[0], alpha);
+			pixel[1] = multiply(pixel[1], alpha);
+			pixel[2] = multiply(pixel[2], alpha);
+		}
+	}
+
+	static void toRGB8(const unsigned char* src, unsigned char* dst, int width) {
+		int x = 0;
+#ifdef PIXEL_CONVERT_NEON
+		for (; x + 16 <= width; x += 16) {
+			uint8x16x4_t pixels = vld4q_u8(src + x * 4);
+			uint8x16x3_t rgb = {{pixels.val[0], pixels.val[1], pixels.val[2]}};
+			vst3q_u8(dst + x * 3, rgb);
+		}
+#endif
+		for (; x < width; x++) {
+			dst[x * 3] = src[x * 4];
+			dst[x * 3 + 1] = src[x * 4 + 1];
+			dst[x * 3 + 2] = src[x * 4 + 2];
+		}
+	}
+
+	static void toL8(const unsigned char* src, unsigned char* dst, int width) {
+		int x = 0;
+#ifdef PIXEL_CONVERT_NEON
+		for (; x + 16 <= width; x += 16) {
+			vst1q_u8(dst + x, vld4q_u8(src + x * 4).val[0]);
+		}
+#endif
+		for (; x < width; x++) {
+			dst[x] = src[x * 4];
+		}
+	}
+
+	static void toLA8(const unsigned char* src, unsigned char* dst, int width) {
+		int x = 0;
+#ifdef PIXEL_CONVERT_NEON
+		for (; x + 16 <= width; x += 16) {
+			uint8x16x4_t pixels = vld4q_u8(src + x * 4);
+			uint8x16x2_t la = {{pixels.val[0], pixels.val[3]}};
+			vst2q_u8(dst + x * 2, la);
+		}
+#endif
+		for (; x < width; x++) {
+			dst[x * 2] = src[x * 4];
+			dst[x * 2 + 1] = src[x * 4 + 3];
+		}
+	}
+
+	static void toRGB565(const unsigned char* src, unsigned short* dst, int width, int y) {
+		const unsigned char* bayer = BAYER[y & 3];
+		int x = 0;
+#ifdef PIXEL_CONVERT_NEON
+		unsigned char dither5[16], dither6[16];
+		for (int i = 0; i < 16; i++) {
+			dither5[i] = bayer[i & 3] >> 1;
+			dither6[i] = bayer[i & 3] >> 2;
+		}
+		uint8x16_t d5 = vld1q_u8(dither5), d6 = vld1q_u8(dither6);
+
+		for (; x + 16 <= width; x += 16) {
+			uint8x16x4_t pixels = vld4q_u8(src + x * 4);
+			uint8x16_t r = vqaddq_u8(pixels.val[0], d5);
+			uint8x16_t g = vqaddq_u8(pixels.val[1], d6);
+			uint8x16_t b = vqaddq_u8(pixels.val[2], d5);
+
+			// r in the top five bits, then g and b shifted in below it
+			uint16x8_t low = vshll_n_u8(vget_low_u8(r), 8);
+			low = vsriq_n_u16(low, vshll_n_u8(vget_low_u8(g), 8), 5);
+			low = vsriq_n_u16(low, vshll_n_u8(vget_low_u8(b), 8), 11);
+			uint16x8_t high = vshll_n_u8(vget_high_u8(r), 8);
+			high = vsriq_n_u16(high, vshll_n_u8(vget_high_u8(g), 8), 5);
+			high = vsriq_n_u16(high, vshll_n_u8(vget_high_u8(b), 8), 11);
+
+			vst1q_u16(dst + x, low);
+			vst1q_u16(dst + x + 8, high);
+		}
+#elif defined(PIXEL_CONVERT_SSE2)
+		unsigned char dither[16];
+		for (int i = 0; i < 4; i++) {
+			dither[i * 4] = bayer[i] >> 1;
+			dither[i * 4 + 1] = bayer[i] >> 2;
+			dither[i * 4 + 2] = bayer[i] >> 1;
+			dither[i * 4 + 3] = 0;
+		}
+		__m128i d = _mm_loadu_si128((const __m128i*) dither);
+		__m128i maskR = _mm_set1_epi32(0xF8), maskG = _mm_set1_epi32(0x7E0), maskB = _mm_set1_epi32(0x1F);
+
+		for (; x + 8 <= width; x += 8) {
+			__m128i packed[2];
+			for (int half = 0; half < 2; half++) {
+				__m128i pixels = _mm_adds_epu8(_mm_loadu_si128((const __m128i*) (src + (x + half * 4) * 4)), d);
+				__m128i value = _mm_slli_epi32(_mm_and_si128(pixels, maskR), 8);
+				value = _mm_or_si128(value, _mm_and_si128(_mm_srli_epi32(pixels, 5), maskG));
+				value = _mm_or_si128(value, _mm_and_si128(_mm_srli_epi32(pixels, 19), maskB));
+				// sign extend so the signed pack keeps all sixteen bits
+				packed[half] = _mm_srai_epi32(_mm_slli_epi32(value, 16), 16);
+			}
+			_mm_storeu_si128((__m128i*) (dst + x), _mm_packs_epi32(packed[0], packed[1]));
+		}
+#endif
+		for (; x < width; x++) {
+			const unsigned char* pixel = src + x * 4;
+			int dither = bayer[x & 3];
+			int r = addSaturated(pixel[0], dither >> 1);
+			int g = addSaturated(pixel[1], dither >> 2);
+			int b = addSaturated(pixel[2], dither >> 1);
+			dst[x] = (unsigned short) (((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+		}
+	}
+
+	static void toRGBA4444(const unsigned char* src, unsigned short* dst, int width, int y) {
+		const unsigned char* bayer = BAYER[y & 3];
+		int x = 0;
+#ifdef PIXEL_CONVERT_NEON
+		unsigned char dither4[16];
+		for (int i = 0; i < 16; i++) {
+			dither4[i] = bayer[i & 3];
+		}
+		uint8x16_t d4 = vld1q_u8(dither4);
+
+		for (; x + 16 <= width; x += 16) {
+			uint8x16x4_t pixels = vld4q_u8(src + x * 4);
+			uint8x16_t r = vqaddq_u8(pixels.val[0], d4);
+			uint8x16_t g = vqaddq_u8(pixels.val[1], d4);
+			uint8x16_t b = vqaddq_u8(pixels.val[2], d4);
+			uint8x16_t a = vqaddq_u8(pixels.val[3], d4);
+
+			// little-endian shorts: low byte is b:a, high byte is r:g
+			uint8x16x2_t bytes = {{vsriq_n_u8(b, a, 4), vsriq_n_u8(r, g, 4)}};
+			vst2q_u8((unsigned char*) (dst + x), bytes);
+		}
+#elif defined(PIXEL_CONVERT_SSE2)
+		unsigned char dither[16];
+		for (int i = 0; i < 16; i++) {
+			dither[i] = bayer[i / 4];
+		}
+		__m128i d = _mm_loadu_si128((const __m128i*) dither);
+		__m128i maskR = _mm_set1_epi32(0xF0), maskG = _mm_set1_epi32(0xF00), maskB = _mm_set1_epi32(0xF0);
+
+		for (; x + 8 <= width; x += 8) {
+			__m128i packed[2];
+			for (int half = 0; half < 2; half++) {
+				__m128i pixels = _mm_adds_epu8(_mm_loadu_si128((const __m128i*) (src + (x + half * 4) * 4)), d);
+				__m128i value = _mm_slli_epi32(_mm_and_si128(pixels, maskR), 8);
+				value = _mm_or_si128(value, _mm_and_si128(_mm_srli_epi32(pixels, 4), maskG));
+				value = _mm_or_si128(value, _mm_and_si128(_mm_srli_epi32(pixels, 16), maskB));
+				value = _mm_or_si128(value, _mm_srli_epi32(pixels, 28));
+				packed[half] = _mm_srai_epi32(_mm_slli_epi32(value, 16), 16);
+			}
+			_mm_storeu_si128((__m128i*) (dst + x), _mm_packs_epi32(packed[0], packed[1]));
+		}
+#endif
+		for (; x < width; x++) {
+			const unsigned char* pixel = src + x * 4;
+			int dither = bayer[x & 3];
+			int r = addSaturated(pixel[0], dither);
+			int g = addSaturated(pixel[1], dither);
+			int b = addSaturated(pixel[2], dither);
+			int a = addSaturated(pixel[3], dither);
+			dst[x] = (unsigned short) (((r & 0xF0) << 8) | ((g & 0xF0) << 4) | (b & 0xF0) | (a >> 4));
+		}
+	}
+
+	void convert(const unsigned char* rgba, int width, int height, int format, unsigned char* out) {
+		int outStride = width * bytesPerPixel(format);
+
+		for (int y = 0; y < height; y++) {
+			const unsigned char* src = rgba + y * width * 4;
+			unsigned char* dst = out + y * outStride;
+
+			switch (format) {
+				case PIXEL_RGB8: toRGB8(src, dst, width); break;
+				case PIXEL_RGB565: toRGB565(src, (unsigned short*) dst, width, y); break;
+				case PIXEL_RGBA4444: toRGBA4444(src, (unsigned short*) dst, width, y); break;
+				case PIXEL_L8: toL8(src, dst, width); break;
+				case PIXEL_LA8: toLA8(src, dst, width); break;
+				default: memcpy(dst, src, width * 4); break;
+			}
+		}
+	}
+
+}
\ No newline at end of file
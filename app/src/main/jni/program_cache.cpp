@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+#include <GLES3/gl3.h>
+
+#include <engine/program_cache.h>
+
+#include <android/log.h>
+
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, "program_cache", __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, "program_cache", __VA_ARGS__))
+
+/**
+ * Keeps linked program binaries (GLES 3.0 glGetProgramBinary) on disk so a
+ * start skips compiling and linking. A file is named after a hash of both
+ * shader sources plus GL_VENDOR, GL_RENDERER and GL_VERSION, so editing a
+ * shader or a driver update simply misses; a binary the driver rejects
+ * anyway is deleted and the caller compiles from source.
+ *
+ *   char[4] magic "CPRG", u32 version, u64 key, u32 binary format, u32 length
+ *   u8[length] binary
+ */
+namespace program_cache {
+
+	static const char MAGIC[4] = {'C', 'P', 'R', 'G'};
+	static const unsigned int VERSION = 1;
+
+	struct header_struct {
+		char magic[4];
+		unsigned int version;
+		unsigned long long key;
+		unsigned int format;
+		unsigned int length;
+	};
+
+	static std::string directory;
+
+	static unsigned long long hash(unsigned long long value, const char* text) {
+		// FNV-1a, the terminator is hashed too so "ab"+"c" differs from "a"+"bc"
+		do {
+			value ^= (unsigned char) *text;
+			value *= 1099511628211ull;
+		} while (*text++ != '\0');
+		return value;
+	}
+
+	static unsigned long long makeKey(const char* vertex, const char* fragment) {
+		unsigned long long key = 14695981039346656037ull;
+		key = hash(key, vertex);
+		key = hash(key, fragment);
+
+		const GLenum driverStrings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+		for (int i = 0; i < 3; i++) {
+			const char* value = (const char*) glGetString(driverStrings[i]);
+			key = hash(key, value != NULL ? value : "");
+		}
+		return key;
+	}
+
+	static std::string pathFor(unsigned long long key) {
+		char name[32];
+		snprintf(name, sizeof(name), "/%016llx.bin", key);
+		return directory + name;
+	}
+
+	static bool supported() {
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		return !directory.empty() && formats > 0;
+	}
+
+	void init(const char* baseDirectory) {
+		directory.clear();
+		if (baseDirectory == NULL) {
+			return;
+		}
+
+		directory = std::string(baseDirectory) + "/program_cache";
+		mkdir(baseDirectory, 0700);
+		mkdir(directory.c_str(), 0700);
+	}
+
+	GLuint load(const char* vertex, const char* fragment) {
+		if (!supported()) {
+			return 0;
+		}
+
+		unsigned long long key = makeKey(vertex, fragment);
+		std::string path = pathFor(key);
+
+		FILE* file = fopen(path.c_str(), "rb");
+		if (file == NULL) {
+			return 0;
+		}
+
+		header_struct header;
+		std::vector<unsigned char> binary;
+		bool valid = fread(&header, sizeof(header), 1, file) == 1
+			&& memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+			&& header.version == VERSION && header.key == key && header.length > 0;
+		if (valid) {
+			binary.resize(header.length);
+			valid = fread(&binary[0], 1, header.length, file) == header.length;
+		}
+		fclose(file);
+
+		GLuint program = 0;
+		if (valid) {
+			program = glCreateProgram();
+			glProgramBinary(program, header.format, &binary[0], header.length);
+
+			GLint linked = GL_FALSE;
+			glGetProgramiv(program, GL_LINK_STATUS, &linked);
+			if (!linked) {
+				glDeleteProgram(program);
+				program = 0;
+			}
+		}
+
+		if (program == 0) {
+			LOGI("Dropping stale program binary %s", path.c_str());
+			remove(path.c_str());
+		}
+		return program;
+	}
+
+	void store(GLuint program, const char* vertex, const char* fragment) {
+		if (program == 0 || !supported()) {
+			return;
+		}
+
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) {
+			return;
+		}
+
+		header_struct header;
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.key = makeKey(vertex, fragment);
+
+		std::vector<unsigned char> binary(length);
+		GLsizei written = 0;
+		GLenum format = 0;
+		glGetProgramBinary(program, length, &written, &format, &binary[0]);
+		if (written <= 0) {
+			return;
+		}
+		header.format = format;
+		header.length = written;
+
+		// written next to the target and renamed, so a crash never leaves half a binary
+		std::string path = pathFor(header.key);
+		std::string temporary = path + ".tmp";
+		FILE* file = fopen(temporary.c_str(), "wb");
+		if (file == NULL) {
+			LOGE("Could not write %s", temporary.c_str());
+			return;
+		}
+		bool complete = fwrite(&header, sizeof(header), 1, file) == 1
+			&& fwrite(&binary[0], 1, written, file) == (size_t) written;
+		complete = fclose(file) == 0 && complete;
+
+		if (complete && rename(temporary.c_str(), path.c_str()) == 0) {
+			LOGI("Stored program binary %s (%i bytes)", path.c_str(), written);
+		}
+		else {
+			remove(temporary.c_str());
+		}
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include <stddef.h>
+
+#include <engine/rect_packer.h>
+
+namespace rect_packer {
+
+	void init(packer* result, int width, int height, int padding) {
+		result->width = width;
+		result->height = height;
+		result->padding = padding;
+		result->usedArea = 0;
+
+		result->skyline.clear();
+		skyline_node node = {0, 0, width};
+		result->skyline.push_back(node);
+	}
+
+	/* Lowest y at which a rect of given size can sit on top of skyline[index]. */
+	static bool fit(const packer* target, size_t index, int width, int height, int* resultY) {
+		const std::vector<skyline_node>& skyline = target->skyline;
+
+		int x = skyline[index].x;
+		if (x + width > target->width) {
+			return false;
+		}
+
+		int y = skyline[index].y;
+		int widthLeft = width;
+		while (widthLeft > 0 && index < skyline.size()) {
+			if (skyline[index].y > y) {
+				y = skyline[index].y;
+			}
+			if (y + height > target->height) {
+				return false;
+			}
+			widthLeft -= skyline[index].width;
+			index++;
+		}
+
+		*resultY = y;
+		return true;
+	}
+
+	static void merge(packer* target) {
+		std::vector<skyline_node>& skyline = target->skyline;
+		for (size_t i = 0; i + 1 < skyline.size();) {
+			if (skyline[i].y == skyline[i + 1].y) {
+				skyline[i].width += skyline[i + 1].width;
+				skyline.erase(skyline.begin() + i + 1);
+			}
+			else {
+				i++;
+			}
+		}
+	}
+
+	bool insert(packer* target, int width, int height, int* resultX, int* resultY) {
+		int paddedWidth = width + target->padding * 2;
+		int paddedHeight = height + target->padding * 2;
+
+		std::vector<skyline_node>& skyline = target->skyline;
+
+		int bestIndex = -1, bestBottom = 0, bestWidth = 0, bestY = 0;
+		for (size_t i = 0; i < skyline.size(); i++) {
+			int y;
+			if (!fit(target, i, paddedWidth, paddedHeight, &y)) {
+				continue;
+			}
+
+			int bottom = y + paddedHeight;
+			if (bestIndex < 0 || bottom < bestBottom || (bottom == bestBottom && skyline[i].width < bestWidth)) {
+				bestIndex = (int) i;
+				bestBottom = bottom;
+				bestWidth = skyline[i].width;
+				bestY = y;
+			}
+		}
+
+		if (bestIndex < 0) {
+			return false;
+		}
+
+		skyline_node node = {skyline[bestIndex].x, bestY + paddedHeight, paddedWidth};
+		skyline.insert(skyline.begin() + bestIndex, node);
+
+		// cut away the part of the skyline now covered by the new node
+		for (size_t i = bestIndex + 1; i < skyline.size();) {
+			const skyline_node& previous = skyline[i - 1];
+			int previousEnd = previous.x + previous.width;
+			if (skyline[i].x >= previousEnd) {
+				break;
+			}
+
+			int shrink = previousEnd - skyline[i].x;
+			skyline[i].x += shrink;
+			skyline[i].width -= shrink;
+			if (skyline[i].width <= 0) {
+				skyline.erase(skyline.begin() + i);
+			}
+			else {
+				break;
+			}
+		}
+
+		merge(target);
+
+		target->usedArea += (long) paddedWidth * paddedHeight;
+
+		*resultX = node.x + target->padding;
+		*resultY = bestY + target->padding;
+		return true;
+	}
+
+	void grow(packer* target, int width, int height) {
+		if (width > target->width) {
+			skyline_node& last = target->skyline.back();
+			if (last.y == 0) {
+				last.width += width - target->width;
+			}
+			else {
+				skyline_node node = {target->width, 0, width - target->width};
+				target->skyline.push_back(node);
+			}
+			target->width = width;
+		}
+
+		if (height > target->height) {
+			target->height = height;
+		}
+	}
+
+	float fillRatio(const packer* target) {
+		return (float) target->usedArea / ((float) target->width * target->height);
+	}
+
+}
\ No newline at end of file
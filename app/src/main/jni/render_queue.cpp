@@ -0,0 +1,326 @@
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include <GLES3/gl3.h>
+
+#include <engine/render_queue.h>
+#include <engine/render_thread.h>
+#include <engine/sprite_batch.h>
+#include <engine/gl_state.h>
+#include <engine/damage_region.h>
+
+/**
+ * Defers the sprites of a frame so they can be reordered for the fewest
+ * state changes before they reach sprite_batch. Every sprite gets a 64-bit
+ * key and the keys are radix sorted; the sort is stable, so equal keys keep
+ * submission order.
+ *
+ * Key layout, most significant bits first:
+ *
+ *   layer (8) | 0 (24) | sequence (32)                          submission ordered layer
+ *   layer (8) | program (8) | texture (16) | depth (24) | 0 (8)   state sorted layer
+ *
+ * The program bits stay zero while sprite_batch only has one program.
+ * Layers draw submission ordered unless setLayerSorted() says overlap
+ * inside that layer doesn't matter (additive effects, non-overlapping tiles).
+ *
+ * The logic thread records a whole frame into one of the render_thread
+ * slots; a camera change starts a new segment, and every segment is sorted
+ * and drawn with its own matrices on the render thread.
+ *
+ * A frame is hashed when it is published; one identical to the last
+ * published frame is dropped unless the caller forces it, so a static
+ * screen costs neither a draw nor a swap.
+ */
+namespace render_queue {
+
+	static const int LAYER_COUNT = 256;
+
+	struct command_struct {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	struct segment_struct {
+		float projection[16];
+		float view[16];
+		size_t firstCommand;
+	};
+
+	struct frame_struct {
+		std::vector<sprite_struct> sprites;
+		std::vector<command_struct> commands;
+		std::vector<segment_struct> segments;
+		bool clearPending;
+		float clearColor[3];
+	};
+
+	static frame_struct frames[render_thread::SLOT_COUNT];
+	static int recording = 0;
+
+	static std::vector<command_struct> scratch;
+
+	static bool sortedLayers[LAYER_COUNT];
+
+	static float projectionMatrix[16];
+	static float viewMatrix[16];
+
+	static uint64_t publishedHash = 0;
+
+	static double frameSortMicros = 0;
+	static int frameCommands = 0;
+
+	static int lastCommands = 0;
+	static float lastSortMicros = 0;
+
+	static double nowMicros() {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return now.tv_sec * 1000000.0 + now.tv_nsec / 1000.0;
+	}
+
+	/* Maps a float onto an unsigned integer with the same ordering. */
+	static inline uint32_t orderedBits(float value) {
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+	}
+
+	static uint64_t makeKey(const sprite_struct& sprite, int layer, uint32_t sequence) {
+		uint64_t key = (uint64_t) (layer & 0xFF) << 56;
+
+		if (!sortedLayers[layer & 0xFF]) {
+			return key | sequence;
+		}
+
+		// smaller z is further from the camera, so ascending z draws back to front
+		uint64_t depth = orderedBits(sprite.z) >> 8;
+
+		return key
+			| ((uint64_t) (sprite.texture & 0xFFFF) << 32)
+			| (depth << 8);
+	}
+
+	/* LSD radix sort by 8-bit digits, skipping digits every key shares. */
+	static void radixSort(command_struct* commands, size_t count) {
+		scratch.resize(count);
+
+		command_struct* source = commands;
+		command_struct* target = &scratch[0];
+
+		for (int shift = 0; shift < 64; shift += 8) {
+			size_t histogram[256];
+			memset(histogram, 0, sizeof(histogram));
+			for (size_t i = 0; i < count; i++) {
+				histogram[(source[i].key >> shift) & 0xFF]++;
+			}
+
+			if (histogram[(source[0].key >> shift) & 0xFF] == count) {
+				continue;
+			}
+
+			size_t offset = 0;
+			for (int i = 0; i < 256; i++) {
+				size_t bucket = histogram[i];
+				histogram[i] = offset;
+				offset += bucket;
+			}
+
+			for (size_t i = 0; i < count; i++) {
+				target[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+			}
+
+			command_struct* swap = source;
+			source = target;
+			target = swap;
+		}
+
+		if (source != commands) {
+			memcpy(commands, source, count * sizeof(command_struct));
+		}
+	}
+
+	/* FNV-1a over 32-bit words, everything hashed is a multiple of four bytes. */
+	static uint64_t hashWords(uint64_t value, const void* data, size_t size) {
+		const uint32_t* words = (const uint32_t*) data;
+		for (size_t i = 0; i < size / 4; i++) {
+			value ^= words[i];
+			value *= 1099511628211ull;
+		}
+		return value;
+	}
+
+	static uint64_t hashFrame(const frame_struct& frame) {
+		uint64_t value = 14695981039346656037ull;
+		if (!frame.sprites.empty()) {
+			value = hashWords(value, &frame.sprites[0], frame.sprites.size() * sizeof(sprite_struct));
+		}
+
+		// the keys carry the layers, the sprites everything else
+		for (size_t i = 0; i < frame.commands.size(); i++) {
+			value = hashWords(value, &frame.commands[i].key, sizeof(uint64_t));
+		}
+
+		for (size_t i = 0; i < frame.segments.size(); i++) {
+			const segment_struct& segment = frame.segments[i];
+			uint32_t firstCommand = (uint32_t) segment.firstCommand;
+			value = hashWords(value, segment.projection, sizeof(segment.projection));
+			value = hashWords(value, segment.view, sizeof(segment.view));
+			value = hashWords(value, &firstCommand, sizeof(firstCommand));
+		}
+
+		uint32_t clearPending = frame.clearPending ? 1 : 0;
+		value = hashWords(value, &clearPending, sizeof(clearPending));
+		if (frame.clearPending) {
+			value = hashWords(value, frame.clearColor, sizeof(frame.clearColor));
+		}
+		return value;
+	}
+
+	static void openSegment(frame_struct& frame) {
+		segment_struct segment;
+		memcpy(segment.projection, projectionMatrix, sizeof(projectionMatrix));
+		memcpy(segment.view, viewMatrix, sizeof(viewMatrix));
+		segment.firstCommand = frame.commands.size();
+		frame.segments.push_back(segment);
+	}
+
+	static void reset(frame_struct& frame) {
+		frame.sprites.clear();
+		frame.commands.clear();
+		frame.segments.clear();
+		frame.clearPending = false;
+		openSegment(frame);
+	}
+
+	void setLayerSorted(int layer, bool sorted) {
+		sortedLayers[layer & 0xFF] = sorted;
+	}
+
+	void setMatrices(const float* projection, const float* view) {
+		memcpy(projectionMatrix, projection, sizeof(projectionMatrix));
+		memcpy(viewMatrix, view, sizeof(viewMatrix));
+
+		frame_struct& frame = frames[recording];
+		if (frame.segments.empty() || frame.segments.back().firstCommand < frame.commands.size()) {
+			openSegment(frame);
+		}
+		else {
+			memcpy(frame.segments.back().projection, projection, sizeof(projectionMatrix));
+			memcpy(frame.segments.back().view, view, sizeof(viewMatrix));
+		}
+	}
+
+	void submit(const sprite_struct& sprite, int layer) {
+		frame_struct& frame = frames[recording];
+		if (frame.segments.empty()) {
+			openSegment(frame);
+		}
+
+		command_struct command;
+		command.index = (uint32_t) frame.sprites.size();
+		command.key = makeKey(sprite, layer, command.index);
+
+		frame.sprites.push_back(sprite);
+		frame.commands.push_back(command);
+	}
+
+	void clear(float colorR, float colorG, float colorB) {
+		// anything recorded so far would be painted over
+		frame_struct& frame = frames[recording];
+		reset(frame);
+
+		frame.clearPending = true;
+		frame.clearColor[0] = colorR;
+		frame.clearColor[1] = colorG;
+		frame.clearColor[2] = colorB;
+	}
+
+	bool publish(bool force) {
+		uint64_t hash = hashFrame(frames[recording]);
+		bool changed = force || hash != publishedHash;
+		publishedHash = hash;
+
+		if (changed) {
+			recording = render_thread::publish(recording);
+		}
+		reset(frames[recording]);
+		return changed;
+	}
+
+	/* Scissors the frame to what changed since the back buffer was drawn, when the surface can tell. */
+	static void limitToDamage(const frame_struct& frame) {
+		if (frame.clearPending) {
+			damage_region::addClear(frame.clearColor);
+		}
+		for (size_t i = 0; i < frame.segments.size(); i++) {
+			const segment_struct& segment = frame.segments[i];
+			size_t end = i + 1 < frame.segments.size() ? frame.segments[i + 1].firstCommand : frame.commands.size();
+
+			damage_region::setMatrices(segment.projection, segment.view);
+			for (size_t j = segment.firstCommand; j < end; j++) {
+				damage_region::add(frame.sprites[frame.commands[j].index], frame.commands[j].key);
+			}
+		}
+
+		int scissor[4];
+		bool partial = damage_region::resolve(scissor);
+		gl_state::setScissor(partial);
+		if (partial) {
+			gl_state::scissor(scissor[0], scissor[1], scissor[2], scissor[3]);
+		}
+	}
+
+	void execute(int slot) {
+		frame_struct& frame = frames[slot];
+
+		if (damage_region::isTracking()) {
+			limitToDamage(frame);
+		}
+
+		if (frame.clearPending) {
+			glClearColor(frame.clearColor[0], frame.clearColor[1], frame.clearColor[2], 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+		}
+
+		double start = nowMicros();
+		for (size_t i = 0; i < frame.segments.size(); i++) {
+			size_t first = frame.segments[i].firstCommand;
+			size_t end = i + 1 < frame.segments.size() ? frame.segments[i + 1].firstCommand : frame.commands.size();
+			if (end > first) {
+				radixSort(&frame.commands[first], end - first);
+			}
+		}
+		frameSortMicros += nowMicros() - start;
+		frameCommands += (int) frame.commands.size();
+
+		for (size_t i = 0; i < frame.segments.size(); i++) {
+			const segment_struct& segment = frame.segments[i];
+			size_t end = i + 1 < frame.segments.size() ? frame.segments[i + 1].firstCommand : frame.commands.size();
+			if (end == segment.firstCommand) {
+				continue;
+			}
+
+			sprite_batch::setMatrices(segment.projection, segment.view);
+			for (size_t j = segment.firstCommand; j < end; j++) {
+				sprite_batch::add(frame.sprites[frame.commands[j].index]);
+			}
+		}
+		sprite_batch::flush();
+	}
+
+	void endFrame() {
+		lastCommands = frameCommands;
+		lastSortMicros = (float) frameSortMicros;
+		frameCommands = 0;
+		frameSortMicros = 0;
+	}
+
+	void getStats(int* commandCount, float* sortMicros) {
+		*commandCount = lastCommands;
+		*sortMicros = lastSortMicros;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include <pthread.h>
+#include <deque>
+
+#include <engine/render_thread.h>
+
+#include <android/log.h>
+
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, "render_thread", __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, "render_thread", __VA_ARGS__))
+
+/**
+ * Owns the EGL context on its own thread so the JS frame and the driver's
+ * work on the previous frame overlap. The logic thread records into one of
+ * SLOT_COUNT command lists and publishes it; the render thread draws the
+ * newest published list. With three slots the logic thread can record one
+ * frame while another waits and a third is drawn; publishing blocks only
+ * while a published frame is still waiting.
+ *
+ * Anything else that needs the context (init, teardown, texture uploads)
+ * goes through runSync(), which runs after any waiting frame is drawn and
+ * blocks the caller until it is done.
+ */
+namespace render_thread {
+
+	struct task_struct {
+		void (*function)(void*);
+		void* argument;
+		bool done;
+	};
+
+	static pthread_t thread;
+	static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+	static bool running = false;
+	static bool quit = false;
+
+	static void (*drawFrame)(int);
+
+	static int readySlot = -1;
+	static int drawingSlot = -1;
+
+	static std::deque<task_struct*> tasks;
+
+	static void* loop(void*) {
+		pthread_mutex_lock(&mutex);
+		while (true) {
+			while (!quit && readySlot < 0 && tasks.empty()) {
+				pthread_cond_wait(&cond, &mutex);
+			}
+
+			// a waiting frame was recorded before any queued task was posted
+			if (readySlot >= 0) {
+				drawingSlot = readySlot;
+				readySlot = -1;
+				pthread_cond_broadcast(&cond);
+				pthread_mutex_unlock(&mutex);
+
+				drawFrame(drawingSlot);
+
+				pthread_mutex_lock(&mutex);
+				drawingSlot = -1;
+				continue;
+			}
+
+			if (!tasks.empty()) {
+				task_struct* task = tasks.front();
+				tasks.pop_front();
+				pthread_mutex_unlock(&mutex);
+
+				task->function(task->argument);
+
+				pthread_mutex_lock(&mutex);
+				task->done = true;
+				pthread_cond_broadcast(&cond);
+				continue;
+			}
+
+			if (quit) {
+				break;
+			}
+		}
+		pthread_mutex_unlock(&mutex);
+
+		return NULL;
+	}
+
+	void start(void (*callback)(int)) {
+		if (running) {
+			return;
+		}
+
+		drawFrame = callback;
+		quit = false;
+		readySlot = -1;
+		drawingSlot = -1;
+
+		if (pthread_create(&thread, NULL, loop, NULL) != 0) {
+			LOGE("Could not start the render thread");
+			return;
+		}
+		running = true;
+	}
+
+	void stop() {
+		if (!running) {
+			return;
+		}
+
+		pthread_mutex_lock(&mutex);
+		quit = true;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&mutex);
+
+		pthread_join(thread, NULL);
+		running = false;
+	}
+
+	int publish(int slot) {
+		if (!running) {
+			return slot;
+		}
+
+		pthread_mutex_lock(&mutex);
+		while (readySlot >= 0) {
+			pthread_cond_wait(&cond, &mutex);
+		}
+		readySlot = slot;
+
+		int next = 0;
+		while (next == readySlot || next == drawingSlot) {
+			next++;
+		}
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&mutex);
+
+		return next;
+	}
+
+	void runSync(void (*function)(void*), void* argument) {
+		if (!running) {
+			function(argument);
+			return;
+		}
+
+		task_struct task = {function, argument, false};
+
+		pthread_mutex_lock(&mutex);
+		tasks.push_back(&task);
+		pthread_cond_broadcast(&cond);
+		while (!task.done) {
+			pthread_cond_wait(&cond, &mutex);
+		}
+		pthread_mutex_unlock(&mutex);
+	}
+
+}
\ No newline at end of file
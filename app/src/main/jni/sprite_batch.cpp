@@ -0,0 +1,324 @@
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#include <GLES3/gl3.h>
+
+#include <engine/sprite_batch.h>
+#include <engine/gl_state.h>
+#include <engine/stream_buffer.h>
+
+#include <android/log.h>
+
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, "sprite_batch", __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, "sprite_batch", __VA_ARGS__))
+
+/**
+ * Collects sprites and issues a single draw call for every run of sprites
+ * sharing a texture. Textures are premultiplied and blended with
+ * (ONE, ONE_MINUS_SRC_ALPHA), so additive sprites only differ by a zero
+ * tint alpha and share the batch with normal ones. Positions are in world
+ * space, so the camera only goes into the u_ModelView uniform once per
+ * flush.
+ *
+ * On ES2 every sprite is expanded into four vertices on the CPU. On ES3 a
+ * static unit quad is drawn instanced and each sprite only uploads one
+ * compact instance record. Either way the data is appended to stream_buffer.
+ */
+namespace sprite_batch {
+
+	static const int MAX_SPRITES = 1024;
+
+	static const GLfloat quadVertices[] = { -1.0f,-1.0f, 1.0f,-1.0f, -1.0f,1.0f, 1.0f,1.0f };
+
+	static const GLubyte quadIndices[] = { 3,0,1, 3,2,0 };
+
+	struct vertex_struct {
+		GLfloat x, y, z;
+		GLfloat u, v;
+		GLuint tint;
+	};
+
+	struct instance_struct {
+		GLfloat x, y, z;
+		GLfloat rotation;
+		GLfloat scaleX, scaleY;
+		GLushort uvRect[4];
+		GLuint tint;
+	};
+
+	static vertex_struct vertices[MAX_SPRITES * 4];
+	static instance_struct instances[MAX_SPRITES];
+	static int spriteCount = 0;
+
+	static bool instanced = false;
+
+	static GLuint program = 0;
+	static GLuint indexBuffer = 0;
+	static GLuint quadBuffer = 0;
+	static GLuint currentTexture = 0;
+
+	static GLint uProjection, uModelView;
+	static GLint aPosition, aTextureUV, aTint;
+	static GLint aCorner, aTransform, aScale, aUVRect;
+
+	static GLfloat projectionMatrix[16];
+	static GLfloat viewMatrix[16];
+
+	static int frameSprites = 0, frameDrawCalls = 0;
+	static double frameMillis = 0;
+	// the clock is read when a batch starts and when it is flushed, never per sprite
+	static double batchStart = 0;
+
+	static int lastSprites = 0, lastDrawCalls = 0;
+	static float lastMillis = 0;
+
+	static double nowMillis() {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+	}
+
+	static void initExpanded() {
+		aPosition = gl_state::attribLocation(program, "a_Position");
+		aTextureUV = gl_state::attribLocation(program, "a_TextureUV");
+		aTint = gl_state::attribLocation(program, "a_Tint");
+
+		GLushort indices[MAX_SPRITES * 6];
+		for (int i = 0; i < MAX_SPRITES; i++) {
+			for (int j = 0; j < 6; j++) {
+				indices[i*6 + j] = (GLushort) (i * 4 + quadIndices[j]);
+			}
+		}
+
+		glGenBuffers(1, &indexBuffer);
+		gl_state::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+	}
+
+	static void initInstanced() {
+		aCorner = gl_state::attribLocation(program, "a_Corner");
+		aTransform = gl_state::attribLocation(program, "a_Transform");
+		aScale = gl_state::attribLocation(program, "a_Scale");
+		aUVRect = gl_state::attribLocation(program, "a_UVRect");
+		aTint = gl_state::attribLocation(program, "a_Tint");
+
+		glGenBuffers(1, &indexBuffer);
+		gl_state::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(quadIndices), quadIndices, GL_STATIC_DRAW);
+
+		glGenBuffers(1, &quadBuffer);
+		gl_state::bindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+
+		// the corners never move, so their pointer is set once here and not per draw
+		glVertexAttribPointer(aCorner, 2, GL_FLOAT, GL_FALSE, 0, (const void*) 0);
+		gl_state::enableVertexAttribArray(aCorner);
+		gl_state::vertexAttribDivisor(aCorner, 0);
+	}
+
+	void init(GLuint programValue, bool instancedValue) {
+		program = programValue;
+		instanced = instancedValue;
+
+		uProjection = gl_state::uniformLocation(program, "u_Projection");
+		uModelView = gl_state::uniformLocation(program, "u_ModelView");
+
+		if (instanced) {
+			initInstanced();
+		}
+		else {
+			initExpanded();
+		}
+
+		spriteCount = 0;
+		currentTexture = 0;
+
+		LOGI("Using %s sprites", instanced ? "instanced" : "expanded");
+	}
+
+	static void deleteBuffer(GLuint* buffer) {
+		if (*buffer != 0) {
+			gl_state::forgetBuffer(*buffer);
+			glDeleteBuffers(1, buffer);
+			*buffer = 0;
+		}
+	}
+
+	void destroy() {
+		deleteBuffer(&indexBuffer);
+		deleteBuffer(&quadBuffer);
+		program = 0;
+		spriteCount = 0;
+	}
+
+	void setMatrices(const float* projection, const float* view) {
+		if (memcmp(projection, projectionMatrix, sizeof(projectionMatrix)) == 0
+			&& memcmp(view, viewMatrix, sizeof(viewMatrix)) == 0) {
+			return;
+		}
+
+		flush();
+
+		memcpy(projectionMatrix, projection, sizeof(projectionMatrix));
+		memcpy(viewMatrix, view, sizeof(viewMatrix));
+	}
+
+	static inline GLushort toUnorm16(float value) {
+		return (GLushort) (value * 65535.0f + 0.5f);
+	}
+
+	static void addInstance(const sprite_struct& sprite) {
+		const float* quad = sprite.quadRect;
+		float halfWidth = (quad[2] - quad[0]) * 0.5f * sprite.scale;
+		float halfHeight = (quad[3] - quad[1]) * 0.5f * sprite.scale;
+		float centerX = (quad[0] + quad[2]) * 0.5f * sprite.scale;
+		float centerY = (quad[1] + quad[3]) * 0.5f * sprite.scale;
+
+		// a trimmed quad isn't centered on the sprite origin, so its center rotates too
+		float cosine = 1.0f, sine = 0.0f;
+		if (sprite.rotation != 0.0f) {
+			cosine = cosf(sprite.rotation);
+			sine = sinf(sprite.rotation);
+		}
+
+		instance_struct& instance = instances[spriteCount];
+		instance.x = sprite.x + centerX * cosine - centerY * sine;
+		instance.y = sprite.y + centerX * sine + centerY * cosine;
+		instance.z = sprite.z;
+		instance.rotation = sprite.rotation;
+		instance.scaleX = halfWidth;
+		instance.scaleY = halfHeight;
+		for (int i = 0; i < 4; i++) {
+			instance.uvRect[i] = toUnorm16(sprite.uvRect[i]);
+		}
+		instance.tint = sprite.tint;
+	}
+
+	static void addExpanded(const sprite_struct& sprite) {
+		float cosine = 1.0f, sine = 0.0f;
+		if (sprite.rotation != 0.0f) {
+			cosine = cosf(sprite.rotation);
+			sine = sinf(sprite.rotation);
+		}
+
+		const float* quad = sprite.quadRect;
+		const float* uv = sprite.uvRect;
+
+		vertex_struct* vertex = vertices + spriteCount * 4;
+		for (int i = 0; i < 4; i++) {
+			bool right = quadVertices[i*2] > 0;
+			bool top = quadVertices[i*2 + 1] > 0;
+
+			float localX = (right ? quad[2] : quad[0]) * sprite.scale;
+			float localY = (top ? quad[3] : quad[1]) * sprite.scale;
+
+			vertex->x = sprite.x + localX * cosine - localY * sine;
+			vertex->y = sprite.y + localX * sine + localY * cosine;
+			vertex->z = sprite.z;
+			vertex->u = right ? uv[2] : uv[0];
+			vertex->v = top ? uv[1] : uv[3];
+			vertex->tint = sprite.tint;
+			vertex++;
+		}
+	}
+
+	void add(const sprite_struct& sprite) {
+		if (sprite.texture != currentTexture || spriteCount == MAX_SPRITES) {
+			flush();
+			currentTexture = sprite.texture;
+		}
+		if (spriteCount == 0) {
+			batchStart = nowMillis();
+		}
+
+		if (instanced) {
+			addInstance(sprite);
+		}
+		else {
+			addExpanded(sprite);
+		}
+
+		spriteCount++;
+		frameSprites++;
+	}
+
+	static void drawExpanded() {
+		size_t offset = stream_buffer::write(vertices, spriteCount * 4 * sizeof(vertex_struct));
+
+		GLsizei stride = sizeof(vertex_struct);
+		glVertexAttribPointer(aPosition, 3, GL_FLOAT, GL_FALSE, stride, (const void*) (offset + offsetof(vertex_struct, x)));
+		gl_state::enableVertexAttribArray(aPosition);
+		glVertexAttribPointer(aTextureUV, 2, GL_FLOAT, GL_FALSE, stride, (const void*) (offset + offsetof(vertex_struct, u)));
+		gl_state::enableVertexAttribArray(aTextureUV);
+		glVertexAttribPointer(aTint, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (const void*) (offset + offsetof(vertex_struct, tint)));
+		gl_state::enableVertexAttribArray(aTint);
+
+		gl_state::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glDrawElements(GL_TRIANGLES, spriteCount * 6, GL_UNSIGNED_SHORT, (const void*) 0);
+	}
+
+	static void drawInstanced() {
+		size_t offset = stream_buffer::write(instances, spriteCount * sizeof(instance_struct));
+
+		GLsizei stride = sizeof(instance_struct);
+		glVertexAttribPointer(aTransform, 4, GL_FLOAT, GL_FALSE, stride, (const void*) (offset + offsetof(instance_struct, x)));
+		glVertexAttribPointer(aScale, 2, GL_FLOAT, GL_FALSE, stride, (const void*) (offset + offsetof(instance_struct, scaleX)));
+		glVertexAttribPointer(aUVRect, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (const void*) (offset + offsetof(instance_struct, uvRect)));
+		glVertexAttribPointer(aTint, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (const void*) (offset + offsetof(instance_struct, tint)));
+
+		GLint perInstance[] = { aTransform, aScale, aUVRect, aTint };
+		for (int i = 0; i < 4; i++) {
+			gl_state::enableVertexAttribArray(perInstance[i]);
+			gl_state::vertexAttribDivisor(perInstance[i], 1);
+		}
+
+		gl_state::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, (const void*) 0, spriteCount);
+	}
+
+	void flush() {
+		if (spriteCount == 0 || program == 0) {
+			spriteCount = 0;
+			return;
+		}
+
+		gl_state::useProgram(program);
+		gl_state::uniformMatrix4(uProjection, projectionMatrix);
+		gl_state::uniformMatrix4(uModelView, viewMatrix);
+
+		gl_state::bindTexture(0, currentTexture);
+		gl_state::blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+		if (instanced) {
+			drawInstanced();
+		}
+		else {
+			drawExpanded();
+		}
+
+		spriteCount = 0;
+		frameDrawCalls++;
+		frameMillis += nowMillis() - batchStart;
+	}
+
+	void endFrame() {
+		flush();
+
+		lastSprites = frameSprites;
+		lastDrawCalls = frameDrawCalls;
+		lastMillis = (float) frameMillis;
+
+		frameSprites = 0;
+		frameDrawCalls = 0;
+		frameMillis = 0;
+	}
+
+	void getStats(int* sprites, int* drawCalls, float* cpuMillis) {
+		*sprites = lastSprites;
+		*drawCalls = lastDrawCalls;
+		*cpuMillis = lastMillis;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include <string.h>
+#include <time.h>
+
+#include <GLES3/gl3.h>
+
+#include <engine/stream_buffer.h>
+#include <engine/gl_state.h>
+
+#include <android/log.h>
+
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, "stream_buffer", __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, "stream_buffer", __VA_ARGS__))
+
+/**
+ * One big GL_ARRAY_BUFFER that every piece of per-frame geometry is appended
+ * to, so no draw sources vertices from client memory.
+ *
+ * On ES3 the buffer is split into SEGMENT_COUNT segments. Writes map the
+ * range unsynchronized, and leaving a segment drops a fence behind it. The
+ * CPU only waits when it comes back around to a segment the GPU hasn't
+ * finished reading. A write never straddles two segments: it would leave
+ * the first one before the draw reading its tail was issued, so the fence
+ * would not cover that draw. Writes have to fit in a segment; the largest,
+ * a full sprite batch, is under 100 KB. ES2 can't map buffers, so there the buffer is orphaned
+ * on every wrap and filled with glBufferSubData.
+ */
+namespace stream_buffer {
+
+	static const int RING_SIZE = 1 << 20;
+	static const int SEGMENT_COUNT = 4;
+	static const int SEGMENT_SIZE = RING_SIZE / SEGMENT_COUNT;
+	static const int ALIGNMENT = 16;
+
+	static const GLuint64 WAIT_TIMEOUT = 1000000000ull;
+
+	static GLuint buffer = 0;
+	static bool mapped = false;
+
+	static int head = 0;
+	static int segment = 0;
+	static GLsync fences[SEGMENT_COUNT];
+
+	static int frameWaits = 0;
+	static double frameWaitMillis = 0;
+
+	static int lastWaits = 0;
+	static float lastWaitMillis = 0;
+
+	static double nowMillis() {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+	}
+
+	void init(bool mapRanges) {
+		mapped = mapRanges;
+		head = 0;
+		segment = 0;
+		memset(fences, 0, sizeof(fences));
+
+		glGenBuffers(1, &buffer);
+		gl_state::bindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, RING_SIZE, NULL, GL_STREAM_DRAW);
+
+		LOGI("Streaming through a %i KB %s ring", RING_SIZE / 1024, mapped ? "mapped" : "orphaned");
+	}
+
+	void destroy() {
+		for (int i = 0; i < SEGMENT_COUNT; i++) {
+			if (fences[i] != 0) {
+				glDeleteSync(fences[i]);
+				fences[i] = 0;
+			}
+		}
+
+		if (buffer != 0) {
+			gl_state::forgetBuffer(buffer);
+			glDeleteBuffers(1, &buffer);
+			buffer = 0;
+		}
+	}
+
+	static void enterSegment(int next) {
+		// every draw reading the segment we leave has been issued by now
+		fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		if (fences[next] != 0) {
+			if (glClientWaitSync(fences[next], 0, 0) == GL_TIMEOUT_EXPIRED) {
+				double start = nowMillis();
+				glClientWaitSync(fences[next], GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT);
+				frameWaitMillis += nowMillis() - start;
+				frameWaits++;
+			}
+			glDeleteSync(fences[next]);
+			fences[next] = 0;
+		}
+
+		segment = next;
+	}
+
+	int write(const void* data, int bytes) {
+		gl_state::bindBuffer(GL_ARRAY_BUFFER, buffer);
+
+		int offset = (head + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+		if (mapped && offset / SEGMENT_SIZE != (offset + bytes - 1) / SEGMENT_SIZE) {
+			offset = (offset / SEGMENT_SIZE + 1) * SEGMENT_SIZE;
+		}
+		if (offset + bytes > RING_SIZE) {
+			offset = 0;
+			if (!mapped) {
+				glBufferData(GL_ARRAY_BUFFER, RING_SIZE, NULL, GL_STREAM_DRAW);
+			}
+		}
+
+		if (mapped) {
+			if (offset / SEGMENT_SIZE != segment) {
+				enterSegment(offset / SEGMENT_SIZE);
+			}
+
+			void* target = glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes,
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			if (target != NULL) {
+				memcpy(target, data, bytes);
+				glUnmapBuffer(GL_ARRAY_BUFFER);
+			}
+			else {
+				glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, data);
+			}
+		}
+		else {
+			glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, data);
+		}
+
+		head = offset + bytes;
+		return offset;
+	}
+
+	void endFrame() {
+		lastWaits = frameWaits;
+		lastWaitMillis = (float) frameWaitMillis;
+		frameWaits = 0;
+		frameWaitMillis = 0;
+	}
+
+	void getStats(int* waits, float* waitMillis) {
+		*waits = lastWaits;
+		*waitMillis = lastWaitMillis;
+	}
+
+}
\ No newline at end of file
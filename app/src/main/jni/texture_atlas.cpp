@@ -0,0 +1,581 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <GLES3/gl3.h>
+
+#include <engine/texture_atlas.h>
+#include <engine/rect_packer.h>
+#include <engine/gl_state.h>
+#include <engine/pixel_convert.h>
+
+#include <android/log.h>
+
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, "texture_atlas", __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, "texture_atlas", __VA_ARGS__))
+
+/**
+ * Packs every cached image into a few large RGBA pages so sprites with
+ * different labels can still land in the same batch. Pages start small and
+ * double in size (copying their old contents on the GPU) until they hit
+ * MAX_PAGE_SIZE, after which a new page is opened.
+ *
+ * Compressed pages are imported whole and sealed: nothing is packed into
+ * them at runtime since they can't be written to or copied on the GPU.
+ * Textures filled on the upload thread are adopted the same way.
+ *
+ * Every page holds a single pixel_format. Pages are grown by attaching the
+ * old texture to a framebuffer, which only works for formats the context
+ * can render to: luminance never, 8-bit RGB and RGBA only on ES3 or with
+ * OES_rgb8_rgba8. The first page of each format is also checked with
+ * glCheckFramebufferStatus. Pages of any other format keep a CPU copy to
+ * grow from.
+ *
+ * On ES3 an image is padded straight into a mapped pixel unpack buffer and
+ * copied into its page from there, so neither a padded copy on the heap nor
+ * the driver's copy of client memory is needed.
+ *
+ * Pages are also the unit of residency. lookup() stamps the page with the
+ * current frame, and once the resident bytes go over the budget the least
+ * recently drawn pages are evicted together with their entries; the
+ * caller reloads those labels on their next use. Pinned pages (cooked
+ * atlases) are never evicted, and neither is anything drawn this frame.
+ *
+ * Entries are added and looked up from the logic thread while pages are
+ * filled, evicted and reported on from the render thread, so every entry
+ * point holds the atlas mutex for the whole call.
+ */
+namespace texture_atlas {
+
+	static const int INITIAL_PAGE_SIZE = 256;
+	static const int MAX_PAGE_SIZE = 2048;
+	static const long DEFAULT_BUDGET = 64L << 20;
+
+	// border pixels are repeated into the padding so linear filtering never
+	// picks up a neighbour
+	static const int PADDING = 1;
+
+	struct page_struct {
+		GLuint texture;
+		rect_packer::packer packer;
+		bool sealed;
+		int format;
+		long bytes;
+		std::vector<unsigned char> shadow;
+		int lastUsed;
+		bool pinned;
+	};
+
+	struct entry_struct {
+		int page;
+		int x, y, width, height;
+		float quad[4];
+	};
+
+	static std::vector<page_struct> pages;
+	static std::map<std::string, entry_struct> entries;
+
+	// textures replaced by a grown page; frames recorded before the growth
+	// may still sample them, so they live until the next frame is drawn
+	static std::vector<GLuint> retired;
+
+	static int maxPageSize = MAX_PAGE_SIZE;
+
+	// per pixel_format, -1 until the first page of it is checked against a framebuffer
+	static int copyable[PIXEL_LA8 + 1];
+	static bool eightBitRenderable = false;
+
+	static long budget = DEFAULT_BUDGET;
+	static int currentFrame = 0;
+	static int evictions = 0;
+
+	static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+	static int nextPowerOfTwo(int value) {
+		int result = 1;
+		while (result < value) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+	static GLuint createPageTexture(int size, int format) {
+		GLenum glFormat, type;
+		pixel_convert::glFormat(format, &glFormat, &type);
+
+		GLuint texture;
+		glGenTextures(1, &texture);
+		gl_state::bindTexture(0, texture);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, glFormat, size, size, 0, glFormat, type, NULL);
+
+		return texture;
+	}
+
+	static void growPage(page_struct& page, int size) {
+		int oldSize = page.packer.width;
+		GLuint texture = createPageTexture(size, page.format);
+
+		if (page.shadow.empty()) {
+			// copy the old page into the corner of the new one without a CPU round trip
+			GLuint framebuffer;
+			glGenFramebuffers(1, &framebuffer);
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, page.texture, 0);
+			glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, oldSize, oldSize);
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glDeleteFramebuffers(1, &framebuffer);
+		}
+		else {
+			GLenum glFormat, type;
+			pixel_convert::glFormat(page.format, &glFormat, &type);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, oldSize, oldSize, glFormat, type, &page.shadow[0]);
+
+			int bpp = pixel_convert::bytesPerPixel(page.format);
+			std::vector<unsigned char> shadow(size * size * bpp, 0);
+			for (int row = 0; row < oldSize; row++) {
+				memcpy(&shadow[row * size * bpp], &page.shadow[row * oldSize * bpp], oldSize * bpp);
+			}
+			page.shadow.swap(shadow);
+		}
+
+		retired.push_back(page.texture);
+
+		page.texture = texture;
+		page.bytes = (long) size * size * pixel_convert::bytesPerPixel(page.format);
+		rect_packer::grow(&page.packer, size, size);
+
+		LOGI("Page grown from %i to %i", oldSize, size);
+	}
+
+	// evicted pages leave an empty slot so the indices of the others stay valid
+	static int storePage(const page_struct& page) {
+		for (size_t i = 0; i < pages.size(); i++) {
+			if (pages[i].texture == 0) {
+				pages[i] = page;
+				return (int) i;
+			}
+		}
+		pages.push_back(page);
+		return (int) pages.size() - 1;
+	}
+
+	static bool isCopyable(GLuint texture, int format) {
+		if (copyable[format] >= 0) {
+			return copyable[format] == 1;
+		}
+
+		copyable[format] = 0;
+		if (pixel_convert::isRenderable(format, eightBitRenderable)) {
+			GLuint framebuffer;
+			glGenFramebuffers(1, &framebuffer);
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+			copyable[format] = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE ? 1 : 0;
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glDeleteFramebuffers(1, &framebuffer);
+		}
+
+		LOGI("%s pages grow %s", pixel_convert::formatName(format), copyable[format] == 1 ? "on the GPU" : "from a CPU copy");
+		return copyable[format] == 1;
+	}
+
+	static int openPage(int size, int format) {
+		page_struct page;
+		page.texture = createPageTexture(size, format);
+		page.sealed = false;
+		page.format = format;
+		page.bytes = (long) size * size * pixel_convert::bytesPerPixel(format);
+		if (!isCopyable(page.texture, format)) {
+			page.shadow.resize(page.bytes, 0);
+		}
+		page.lastUsed = currentFrame;
+		page.pinned = false;
+		rect_packer::init(&page.packer, size, size, PADDING);
+
+		return storePage(page);
+	}
+
+	static void evictPage(int pageIndex) {
+		std::map<std::string, entry_struct>::iterator entry = entries.begin();
+		while (entry != entries.end()) {
+			if (entry->second.page == pageIndex) {
+				entries.erase(entry++);
+			}
+			else {
+				++entry;
+			}
+		}
+
+		page_struct& page = pages[pageIndex];
+		LOGI("Evicting page %i (%li KB, last drawn %i frames ago)", pageIndex, page.bytes / 1024, currentFrame - page.lastUsed);
+
+		// frames recorded before the eviction may still sample it
+		retired.push_back(page.texture);
+		page.texture = 0;
+		page.bytes = 0;
+		page.sealed = true;
+		std::vector<unsigned char>().swap(page.shadow);
+		evictions++;
+	}
+
+	static void enforceBudget(int keepPage) {
+		long total = 0;
+		for (size_t i = 0; i < pages.size(); i++) {
+			total += pages[i].bytes;
+		}
+
+		while (total > budget) {
+			int victim = -1;
+			for (size_t i = 0; i < pages.size(); i++) {
+				const page_struct& page = pages[i];
+				if (page.texture == 0 || page.pinned || (int) i == keepPage || page.lastUsed >= currentFrame) {
+					continue;
+				}
+				if (victim < 0 || page.lastUsed < pages[victim].lastUsed) {
+					victim = (int) i;
+				}
+			}
+
+			if (victim < 0) {
+				LOGI("%li KB resident is over the %li KB budget but all of it is in use", total / 1024, budget / 1024);
+				return;
+			}
+
+			total -= pages[victim].bytes;
+			evictPage(victim);
+		}
+	}
+
+	static bool place(int width, int height, int format, int* pageIndex, int* x, int* y) {
+		for (size_t i = 0; i < pages.size(); i++) {
+			page_struct& page = pages[i];
+			if (page.sealed || page.format != format) {
+				continue;
+			}
+			while (true) {
+				if (rect_packer::insert(&page.packer, width, height, x, y)) {
+					*pageIndex = (int) i;
+					return true;
+				}
+				if (page.packer.width >= maxPageSize) {
+					break;
+				}
+				growPage(page, page.packer.width * 2);
+			}
+		}
+
+		int paddedSize = nextPowerOfTwo(width > height ? width + PADDING * 2 : height + PADDING * 2);
+		if (paddedSize > maxPageSize) {
+			return false;
+		}
+
+		*pageIndex = openPage(paddedSize > INITIAL_PAGE_SIZE ? paddedSize : INITIAL_PAGE_SIZE, format);
+		return rect_packer::insert(&pages[*pageIndex].packer, width, height, x, y);
+	}
+
+	static bool unpackBuffers = false;
+	static GLuint unpackBuffer = 0;
+
+	static bool hasExtension(const char* extensions, const char* name) {
+		size_t length = strlen(name);
+		for (const char* found = strstr(extensions, name); found != NULL; found = strstr(found + length, name)) {
+			if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0')) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void init(bool isES3) {
+		GLint maxTextureSize = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+		const char* extensions = (const char*) glGetString(GL_EXTENSIONS);
+
+		pthread_mutex_lock(&mutex);
+		unpackBuffers = isES3;
+		unpackBuffer = 0;
+		maxPageSize = maxTextureSize > 0 && maxTextureSize < MAX_PAGE_SIZE ? maxTextureSize : MAX_PAGE_SIZE;
+		eightBitRenderable = isES3 || (extensions != NULL && hasExtension(extensions, "GL_OES_rgb8_rgba8"));
+		for (int i = 0; i <= PIXEL_LA8; i++) {
+			copyable[i] = -1;
+		}
+		pthread_mutex_unlock(&mutex);
+	}
+
+	static void deleteRetired() {
+		for (size_t i = 0; i < retired.size(); i++) {
+			gl_state::forgetTexture(retired[i]);
+			glDeleteTextures(1, &retired[i]);
+		}
+		retired.clear();
+	}
+
+	void releaseRetired() {
+		pthread_mutex_lock(&mutex);
+		deleteRetired();
+		pthread_mutex_unlock(&mutex);
+	}
+
+	void destroy() {
+		pthread_mutex_lock(&mutex);
+		deleteRetired();
+		for (size_t i = 0; i < pages.size(); i++) {
+			if (pages[i].texture != 0) {
+				gl_state::forgetTexture(pages[i].texture);
+				glDeleteTextures(1, &pages[i].texture);
+			}
+		}
+		pages.clear();
+		entries.clear();
+
+		if (unpackBuffer != 0) {
+			glDeleteBuffers(1, &unpackBuffer);
+			unpackBuffer = 0;
+		}
+		pthread_mutex_unlock(&mutex);
+	}
+
+	/* Writes the image with its border repeated into the padding, stride bytes per row. */
+	static void writePadded(unsigned char* target, int stride, const unsigned char* pixels, int width, int height, int bpp) {
+		int rowBytes = width * bpp;
+		for (int row = 0; row < height + PADDING * 2; row++) {
+			int sourceRow = row - PADDING;
+			sourceRow = sourceRow < 0 ? 0 : (sourceRow >= height ? height - 1 : sourceRow);
+			const unsigned char* source = pixels + sourceRow * rowBytes;
+			unsigned char* out = target + row * stride;
+
+			for (int i = 0; i < PADDING; i++) {
+				memcpy(out + i * bpp, source, bpp);
+				memcpy(out + (PADDING + width + i) * bpp, source + rowBytes - bpp, bpp);
+			}
+			memcpy(out + PADDING * bpp, source, rowBytes);
+		}
+	}
+
+	static bool uploadThroughBuffer(int x, int y, GLenum glFormat, GLenum type, const unsigned char* pixels, int width, int height, int bpp) {
+		if (!unpackBuffers) {
+			return false;
+		}
+		if (unpackBuffer == 0) {
+			glGenBuffers(1, &unpackBuffer);
+		}
+
+		int paddedWidth = width + PADDING * 2;
+		int paddedHeight = height + PADDING * 2;
+		long bytes = (long) paddedWidth * paddedHeight * bpp;
+
+		// gl_state only shadows vertex and index buffers, this binding never outlives the call
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffer);
+		// fresh storage every time, so a copy still reading the previous image never stalls this one
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+		unsigned char* target = (unsigned char*) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+		bool uploaded = target != NULL;
+		if (uploaded) {
+			writePadded(target, paddedWidth * bpp, pixels, width, height, bpp);
+			// the contents are undefined if the mapping was lost meanwhile
+			uploaded = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+		}
+		if (uploaded) {
+			glTexSubImage2D(GL_TEXTURE_2D, 0, x - PADDING, y - PADDING, paddedWidth, paddedHeight, glFormat, type, (const void*) 0);
+		}
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return uploaded;
+	}
+
+	bool add(const char* label, const unsigned char* pixels, int width, int height, int format) {
+		pthread_mutex_lock(&mutex);
+
+		int pageIndex, x, y;
+		if (!place(width, height, format, &pageIndex, &x, &y)) {
+			LOGE("%s (%ix%i) doesn't fit into a %i page", label, width, height, maxPageSize);
+			pthread_mutex_unlock(&mutex);
+			return false;
+		}
+
+		int bpp = pixel_convert::bytesPerPixel(format);
+		page_struct& page = pages[pageIndex];
+		GLenum glFormat, type;
+		pixel_convert::glFormat(format, &glFormat, &type);
+
+		gl_state::bindTexture(0, page.texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		if (!uploadThroughBuffer(x, y, glFormat, type, pixels, width, height, bpp)) {
+			int paddedWidth = width + PADDING * 2;
+			int paddedHeight = height + PADDING * 2;
+			unsigned char* padded = (unsigned char*) malloc(paddedWidth * paddedHeight * bpp);
+			writePadded(padded, paddedWidth * bpp, pixels, width, height, bpp);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, x - PADDING, y - PADDING, paddedWidth, paddedHeight, glFormat, type, padded);
+			free(padded);
+		}
+
+		if (!page.shadow.empty()) {
+			int pageStride = page.packer.width * bpp;
+			writePadded(&page.shadow[(y - PADDING) * pageStride + (x - PADDING) * bpp], pageStride, pixels, width, height, bpp);
+		}
+
+		entry_struct entry = {pageIndex, x, y, width, height, {-1.0f, -1.0f, 1.0f, 1.0f}};
+		entries[label] = entry;
+
+		enforceBudget(pageIndex);
+
+		pthread_mutex_unlock(&mutex);
+		return true;
+	}
+
+	int importPage(const unsigned char* rgba, int size) {
+		pthread_mutex_lock(&mutex);
+		int pageIndex = openPage(size, PIXEL_RGBA8);
+		page_struct& page = pages[pageIndex];
+		page.pinned = true;
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+
+		// cooked pages are already packed, runtime additions only go into space gained by growing
+		page.packer.skyline[0].y = size;
+
+		pthread_mutex_unlock(&mutex);
+		return pageIndex;
+	}
+
+	int importCompressedPage(GLenum format, const unsigned char* data, int dataSize, int width, int height, int padding) {
+		GLuint texture;
+		glGenTextures(1, &texture);
+		gl_state::bindTexture(0, texture);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+		// only report errors caused by the upload itself
+		while (glGetError() != GL_NO_ERROR) {}
+		glCompressedTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, dataSize, data);
+		if (glGetError() != GL_NO_ERROR) {
+			LOGE("Compressed upload of %ix%i format 0x%x failed", width, height, format);
+			gl_state::forgetTexture(texture);
+			glDeleteTextures(1, &texture);
+			return -1;
+		}
+
+		return adoptPage(texture, PIXEL_RGBA8, dataSize, width, height, padding);
+	}
+
+	int adoptPage(GLuint texture, int format, long bytes, int width, int height, int padding) {
+		page_struct page;
+		page.texture = texture;
+		page.sealed = true;
+		page.format = format;
+		page.bytes = bytes;
+		page.pinned = false;
+		rect_packer::init(&page.packer, width, height, padding);
+		page.packer.skyline[0].y = height;
+
+		pthread_mutex_lock(&mutex);
+		page.lastUsed = currentFrame;
+		int pageIndex = storePage(page);
+		enforceBudget(pageIndex);
+		pthread_mutex_unlock(&mutex);
+
+		return pageIndex;
+	}
+
+	void pinPage(int pageIndex) {
+		pthread_mutex_lock(&mutex);
+		pages[pageIndex].pinned = true;
+		pthread_mutex_unlock(&mutex);
+	}
+
+	void addEntry(const char* label, int pageIndex, int x, int y, int width, int height, const float* quadRect) {
+		entry_struct entry = {pageIndex, x, y, width, height, {quadRect[0], quadRect[1], quadRect[2], quadRect[3]}};
+
+		pthread_mutex_lock(&mutex);
+		entries[label] = entry;
+
+		int padding = pages[pageIndex].packer.padding;
+		pages[pageIndex].packer.usedArea += (long) (width + padding * 2) * (height + padding * 2);
+		pthread_mutex_unlock(&mutex);
+	}
+
+	bool lookup(const char* label, GLuint* texture, float* uvRect, float* quadRect) {
+		pthread_mutex_lock(&mutex);
+
+		std::map<std::string, entry_struct>::iterator found = entries.find(label);
+		if (found == entries.end()) {
+			pthread_mutex_unlock(&mutex);
+			return false;
+		}
+
+		const entry_struct& entry = found->second;
+		page_struct& page = pages[entry.page];
+		page.lastUsed = currentFrame;
+		float width = (float) page.packer.width;
+		float height = (float) page.packer.height;
+
+		*texture = page.texture;
+		uvRect[0] = entry.x / width;
+		uvRect[1] = entry.y / height;
+		uvRect[2] = (entry.x + entry.width) / width;
+		uvRect[3] = (entry.y + entry.height) / height;
+		memcpy(quadRect, entry.quad, sizeof(entry.quad));
+
+		pthread_mutex_unlock(&mutex);
+		return true;
+	}
+
+	void nextFrame() {
+		pthread_mutex_lock(&mutex);
+		currentFrame++;
+		pthread_mutex_unlock(&mutex);
+	}
+
+	void setBudget(int kilobytes) {
+		pthread_mutex_lock(&mutex);
+		budget = (long) kilobytes * 1024;
+		enforceBudget(-1);
+		pthread_mutex_unlock(&mutex);
+	}
+
+	void getStats(int* pageCount, float* fillRatio, int* kilobytes) {
+		long used = 0, total = 0, bytes = 0;
+		int resident = 0;
+
+		pthread_mutex_lock(&mutex);
+		for (size_t i = 0; i < pages.size(); i++) {
+			if (pages[i].texture == 0) {
+				continue;
+			}
+			used += pages[i].packer.usedArea;
+			total += (long) pages[i].packer.width * pages[i].packer.height;
+			bytes += pages[i].bytes;
+			resident++;
+		}
+		pthread_mutex_unlock(&mutex);
+
+		*pageCount = resident;
+		*fillRatio = total > 0 ? (float) used / total : 0.0f;
+		*kilobytes = (int) (bytes / 1024);
+	}
+
+	void getResidency(int* entryCount, int* evictionCount, int* budgetKilobytes) {
+		pthread_mutex_lock(&mutex);
+		*entryCount = (int) entries.size();
+		*evictionCount = evictions;
+		*budgetKilobytes = (int) (budget / 1024);
+		pthread_mutex_unlock(&mutex);
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include <pthread.h>
+#include <deque>
+
+#include <EGL/egl.h>
+
+#include <engine/upload_thread.h>
+
+#include <android/log.h>
+
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, "upload_thread", __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, "upload_thread", __VA_ARGS__))
+
+#ifndef EGL_OPENGL_ES3_BIT_KHR
+#define EGL_OPENGL_ES3_BIT_KHR 0x0040
+#endif
+
+/**
+ * A second ES3 context in the render context's share group, current on its
+ * own thread over a 1x1 pbuffer, so big glTexImage2D calls never land in a
+ * frame. Tasks create and fill textures with plain GL calls (gl_state only
+ * shadows the render context), then fence and flush; the render thread
+ * glWaitSync()s on that fence before it first draws with the texture.
+ *
+ * stop() runs everything still queued before tearing the context down, so
+ * every submitted argument comes back through takeCompleted().
+ */
+namespace upload_thread {
+
+	struct task_struct {
+		void (*function)(void*);
+		void* argument;
+	};
+
+	static pthread_t thread;
+	static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+	static bool running = false;
+	static bool quit = false;
+	static int ready = 0;
+
+	static EGLDisplay display = EGL_NO_DISPLAY;
+	static EGLContext context = EGL_NO_CONTEXT;
+	static EGLSurface pbuffer = EGL_NO_SURFACE;
+
+	static std::deque<task_struct> tasks;
+	static std::deque<void*> completed;
+
+	static void* loop(void*) {
+		bool current = eglMakeCurrent(display, pbuffer, pbuffer, context) == EGL_TRUE;
+
+		pthread_mutex_lock(&mutex);
+		ready = current ? 1 : -1;
+		pthread_cond_broadcast(&cond);
+
+		while (current) {
+			while (!quit && tasks.empty()) {
+				pthread_cond_wait(&cond, &mutex);
+			}
+			if (tasks.empty()) {
+				break;
+			}
+
+			task_struct task = tasks.front();
+			tasks.pop_front();
+			pthread_mutex_unlock(&mutex);
+
+			task.function(task.argument);
+
+			pthread_mutex_lock(&mutex);
+			completed.push_back(task.argument);
+		}
+		pthread_mutex_unlock(&mutex);
+
+		if (current) {
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			eglReleaseThread();
+		}
+		return NULL;
+	}
+
+	static void destroyContext() {
+		if (context != EGL_NO_CONTEXT) {
+			eglDestroyContext(display, context);
+			context = EGL_NO_CONTEXT;
+		}
+		if (pbuffer != EGL_NO_SURFACE) {
+			eglDestroySurface(display, pbuffer);
+			pbuffer = EGL_NO_SURFACE;
+		}
+	}
+
+	bool start(EGLDisplay displayValue, EGLContext shared) {
+		if (running) {
+			return true;
+		}
+
+		const EGLint configAttribs[] = {
+				EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,
+				EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+				EGL_BLUE_SIZE, 8,
+				EGL_GREEN_SIZE, 8,
+				EGL_RED_SIZE, 8,
+				EGL_NONE
+		};
+		const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		const EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+
+		display = displayValue;
+
+		EGLConfig config;
+		EGLint numConfigs = 0;
+		if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+			LOGE("No pbuffer config for the upload context");
+			return false;
+		}
+
+		pbuffer = eglCreatePbufferSurface(display, config, pbufferAttribs);
+		context = eglCreateContext(display, config, shared, contextAttribs);
+		if (pbuffer == EGL_NO_SURFACE || context == EGL_NO_CONTEXT) {
+			LOGE("Could not create the shared upload context");
+			destroyContext();
+			return false;
+		}
+
+		quit = false;
+		ready = 0;
+		if (pthread_create(&thread, NULL, loop, NULL) != 0) {
+			LOGE("Could not start the upload thread");
+			destroyContext();
+			return false;
+		}
+
+		pthread_mutex_lock(&mutex);
+		while (ready == 0) {
+			pthread_cond_wait(&cond, &mutex);
+		}
+		pthread_mutex_unlock(&mutex);
+
+		if (ready < 0) {
+			LOGE("Could not make the upload context current");
+			pthread_join(thread, NULL);
+			destroyContext();
+			return false;
+		}
+
+		running = true;
+		LOGI("Uploading on a shared context");
+		return true;
+	}
+
+	void stop() {
+		if (!running) {
+			return;
+		}
+
+		pthread_mutex_lock(&mutex);
+		quit = true;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&mutex);
+
+		pthread_join(thread, NULL);
+		destroyContext();
+		running = false;
+	}
+
+	bool isRunning() {
+		return running;
+	}
+
+	void submit(void (*function)(void*), void* argument) {
+		task_struct task = {function, argument};
+
+		pthread_mutex_lock(&mutex);
+		tasks.push_back(task);
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&mutex);
+	}
+
+	bool takeCompleted(void** argument) {
+		pthread_mutex_lock(&mutex);
+		bool found = !completed.empty();
+		if (found) {
+			*argument = completed.front();
+			completed.pop_front();
+		}
+		pthread_mutex_unlock(&mutex);
+
+		return found;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include <pthread.h>
+#include <unistd.h>
+#include <deque>
+
+#include <engine/worker_pool.h>
+
+#include <android/log.h>
+
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, "worker_pool", __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, "worker_pool", __VA_ARGS__))
+
+/**
+ * A few background threads for CPU work that must not stall a frame, like
+ * reading and decoding images. Jobs never touch GL; once a job has run its
+ * argument is queued for the logic thread, which collects it with
+ * takeCompleted() and does whatever needs the context through
+ * render_thread::runSync().
+ *
+ * stop() lets the running jobs finish and drops the ones not yet started;
+ * their arguments still show up in takeCompleted(), so nothing leaks.
+ *
+ * There is a worker per core besides the one the logic thread runs on, so a
+ * batch of decodes scales with the device.
+ */
+namespace worker_pool {
+
+	struct job_struct {
+		void (*function)(void*);
+		void* argument;
+	};
+
+	static pthread_t threads[MAX_WORKERS];
+	static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+	static pthread_cond_t completedCond = PTHREAD_COND_INITIALIZER;
+
+	static int running = 0;
+	static bool quit = false;
+
+	static std::deque<job_struct> jobs;
+	static std::deque<void*> completed;
+
+	static void* loop(void*) {
+		pthread_mutex_lock(&mutex);
+		while (true) {
+			while (!quit && jobs.empty()) {
+				pthread_cond_wait(&cond, &mutex);
+			}
+			if (quit) {
+				break;
+			}
+
+			job_struct job = jobs.front();
+			jobs.pop_front();
+			pthread_mutex_unlock(&mutex);
+
+			job.function(job.argument);
+
+			pthread_mutex_lock(&mutex);
+			completed.push_back(job.argument);
+			pthread_cond_signal(&completedCond);
+		}
+		pthread_mutex_unlock(&mutex);
+
+		return NULL;
+	}
+
+	void start() {
+		if (running > 0) {
+			return;
+		}
+
+		long cores = sysconf(_SC_NPROCESSORS_CONF);
+		int count = cores > 2 ? (int) cores - 1 : 2;
+		count = count < MAX_WORKERS ? count : MAX_WORKERS;
+
+		quit = false;
+		for (int i = 0; i < count; i++) {
+			if (pthread_create(&threads[running], NULL, loop, NULL) != 0) {
+				LOGE("Could not start worker %i", i);
+				break;
+			}
+			running++;
+		}
+		LOGI("%i workers for %li cores", running, cores);
+	}
+
+	int getWorkerCount() {
+		return running;
+	}
+
+	void stop() {
+		if (running == 0) {
+			return;
+		}
+
+		pthread_mutex_lock(&mutex);
+		quit = true;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&mutex);
+
+		for (int i = 0; i < running; i++) {
+			pthread_join(threads[i], NULL);
+		}
+		running = 0;
+
+		while (!jobs.empty()) {
+			completed.push_back(jobs.front().argument);
+			jobs.pop_front();
+		}
+	}
+
+	void submit(void (*function)(void*), void* argument) {
+		if (running == 0) {
+			function(argument);
+			pthread_mutex_lock(&mutex);
+			completed.push_back(argument);
+			pthread_mutex_unlock(&mutex);
+			return;
+		}
+
+		job_struct job = {function, argument};
+
+		pthread_mutex_lock(&mutex);
+		jobs.push_back(job);
+		pthread_cond_signal(&cond);
+		pthread_mutex_unlock(&mutex);
+	}
+
+	bool takeCompleted(void** argument) {
+		pthread_mutex_lock(&mutex);
+		bool found = !completed.empty();
+		if (found) {
+			*argument = completed.front();
+			completed.pop_front();
+		}
+		pthread_mutex_unlock(&mutex);
+
+		return found;
+	}
+
+	/* Blocks until a job completes, only for a caller that knows one is still queued. */
+	void waitCompleted(void** argument) {
+		pthread_mutex_lock(&mutex);
+		while (completed.empty()) {
+			pthread_cond_wait(&completedCond, &mutex);
+		}
+		*argument = completed.front();
+		completed.pop_front();
+		pthread_mutex_unlock(&mutex);
+	}
+
+}
\ No newline at end of file
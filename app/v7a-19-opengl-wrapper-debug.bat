@@ -1 +1 @@
-armv7a-19-g++ -Isrc/main/jni/include -Lsrc/main/jniLibs/armeabi-v7a src/main/jni/opengl_wrapper.cpp -lGLESv3 -lEGL -landroid -lgnustl_shared -llog -o src/main/jniLibs/armeabi-v7a/libopengl-wrapper.so
\ No newline at end of file
+armv7a-19-g++ -march=armv7-a -mfloat-abi=softfp -mfpu=neon -Isrc/main/jni/include -Lsrc/main/jniLibs/armeabi-v7a src/main/jni/opengl_wrapper.cpp src/main/jni/sprite_batch.cpp src/main/jni/gl_state.cpp src/main/jni/rect_packer.cpp src/main/jni/texture_atlas.cpp src/main/jni/render_queue.cpp src/main/jni/render_thread.cpp src/main/jni/stream_buffer.cpp src/main/jni/pixel_convert.cpp src/main/jni/worker_pool.cpp src/main/jni/upload_thread.cpp src/main/jni/program_cache.cpp src/main/jni/frame_scheduler.cpp src/main/jni/damage_region.cpp src/main/jni/asset_stream.cpp -lGLESv3 -lEGL -landroid -lgnustl_shared -llog -o src/main/jniLibs/armeabi-v7a/libopengl-wrapper.so
\ No newline at end of file
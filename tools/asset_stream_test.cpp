@@ -0,0 +1,173 @@
+/**
+ * Host test for asset_stream, with stb_image's allocations counted. Every
+ * image is decoded through loadImage from a folder standing in for the APK
+ * (tools/host/host_assets), once stored and once compressed, and compared
+ * with a decode of the file read onto the heap, which is what the engine
+ * did before. Checks that the pixels match, that either way the peak is
+ * the decode alone with the file never copied onto the heap, that nothing
+ * stays allocated or open afterwards, and that mapAsset only hands out
+ * assets with the expected magic. Prints the peaks.
+ *
+ * Usage: asset_stream_test [image or folder]...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static long allocated = 0, peak = 0;
+
+/* Every block carries its size in front so frees and reallocs can be counted. */
+static void* countedMalloc(size_t size) {
+	size_t* block = (size_t*) malloc(size + 16);
+	*block = size;
+	allocated += size;
+	peak = allocated > peak ? allocated : peak;
+	return (char*) block + 16;
+}
+
+static void countedFree(void* pointer) {
+	if (pointer == NULL) {
+		return;
+	}
+	size_t* block = (size_t*) ((char*) pointer - 16);
+	allocated -= *block;
+	free(block);
+}
+
+static void* countedRealloc(void* pointer, size_t size) {
+	void* resized = countedMalloc(size);
+	if (pointer != NULL) {
+		size_t old = *(size_t*) ((char*) pointer - 16);
+		memcpy(resized, pointer, old < size ? old : size);
+		countedFree(pointer);
+	}
+	return resized;
+}
+
+static void resetCounters() {
+	allocated = 0;
+	peak = 0;
+}
+
+#define STBI_MALLOC countedMalloc
+#define STBI_FREE countedFree
+#define STBI_REALLOC countedRealloc
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <engine/asset_stream.h>
+
+#include "host/host_assets.h"
+#include "host/image_files.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%i: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (0)
+
+static void testImage(AAssetManager* assets, const std::string& path) {
+	std::vector<unsigned char> file;
+	CHECK(image_files::read(path, &file));
+	if (file.empty()) {
+		return;
+	}
+
+	// the file read onto the heap first, then decoded
+	resetCounters();
+	unsigned char* copy = (unsigned char*) countedMalloc(file.size());
+	memcpy(copy, &file[0], file.size());
+	int width, height, channels;
+	unsigned char* reference = stbi_load_from_memory(copy, (int) file.size(), &width, &height, &channels, 4);
+	countedFree(copy);
+	long wholeFilePeak = peak;
+	CHECK(reference != NULL);
+	if (reference == NULL) {
+		return;
+	}
+	long decodedBytes = (long) width * height * 4;
+
+	long peaks[2];
+	for (int compressed = 0; compressed < 2; compressed++) {
+		host_assets::setCompressed(compressed != 0);
+		resetCounters();
+
+		int loadedWidth, loadedHeight, loadedChannels;
+		unsigned char* image = asset_stream::loadImage(assets, path.c_str(), &loadedWidth, &loadedHeight, &loadedChannels);
+		CHECK(image != NULL);
+		if (image == NULL) {
+			continue;
+		}
+		CHECK(loadedWidth == width && loadedHeight == height && loadedChannels == channels);
+		CHECK(memcmp(image, reference, decodedBytes) == 0);
+
+		peaks[compressed] = peak;
+		stbi_image_free(image);
+		CHECK(allocated == 0);
+		CHECK(host_assets::openAssets() == 0);
+	}
+
+	// mapped or streamed, the only thing missing from the old peak is the file itself
+	CHECK(peaks[0] == wholeFilePeak - (long) file.size());
+	CHECK(peaks[1] == wholeFilePeak - (long) file.size());
+
+	printf("%-50s %4ix%-4i file %7li, peak read whole %8li, mapped %8li, streamed %8li\n", path.c_str(),
+		width, height, (long) file.size(), wholeFilePeak, peaks[0], peaks[1]);
+	stbi_image_free(reference);
+}
+
+static void testMapAsset(AAssetManager* assets, const std::string& path) {
+	static const unsigned char PNG_MAGIC[4] = {0x89, 'P', 'N', 'G'};
+	static const unsigned char OTHER_MAGIC[4] = {'C', 'P', 'T', 'X'};
+
+	std::vector<unsigned char> file;
+	image_files::read(path, &file);
+
+	host_assets::setCompressed(false);
+	const unsigned char* data = NULL;
+	int size = 0;
+	void* asset = asset_stream::mapAsset(assets, path.c_str(), PNG_MAGIC, sizeof(PNG_MAGIC), &data, &size);
+	CHECK(asset != NULL);
+	CHECK(size == (int) file.size() && data != NULL && memcmp(data, &file[0], size) == 0);
+	asset_stream::closeAsset(asset);
+
+	CHECK(asset_stream::mapAsset(assets, path.c_str(), OTHER_MAGIC, sizeof(OTHER_MAGIC), &data, &size) == NULL);
+	CHECK(asset_stream::mapAsset(assets, "missing.png", PNG_MAGIC, sizeof(PNG_MAGIC), &data, &size) == NULL);
+	CHECK(host_assets::openAssets() == 0);
+
+	int width, height, channels;
+	CHECK(asset_stream::loadImage(assets, "missing.png", &width, &height, &channels) == NULL);
+}
+
+int main(int argc, char** argv) {
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		image_files::collect(argv[i], ".png", &paths);
+	}
+	if (argc == 1) {
+		image_files::collect("app/src/main/assets/images", ".png", &paths);
+	}
+	CHECK(!paths.empty());
+
+	// paths are relative to the working directory, which stands in for the APK root
+	AAssetManager* assets = host_assets::open(".");
+	for (size_t i = 0; i < paths.size(); i++) {
+		testImage(assets, paths[i]);
+	}
+	if (!paths.empty()) {
+		testMapAsset(assets, paths[0]);
+	}
+
+	if (failures != 0) {
+		printf("asset_stream_test: %i checks failed\n", failures);
+		return 1;
+	}
+	printf("asset_stream_test: passed\n");
+	return 0;
+}
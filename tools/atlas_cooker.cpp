@@ -0,0 +1,305 @@
+/**
+ * Host-side atlas cooker. Walks images/with_alpha and images/no_alpha of the
+ * assets folder, trims fully transparent borders, packs everything into
+ * square power-of-two pages and writes them as uncompressed TGA together with
+ * the binary index described in engine/atlas_format.h.
+ *
+ * Usage: atlas_cooker <assets folder> <output folder inside assets> <name>
+ */
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <engine/rect_packer.h>
+#include <engine/atlas_format.h>
+
+static const int INITIAL_PAGE_SIZE = 256;
+
+struct image_struct {
+	std::string label;
+	unsigned char* pixels;
+	int sourceWidth, sourceHeight;
+	int trimX, trimY, width, height;
+	int page, x, y;
+};
+
+struct page_struct {
+	rect_packer::packer packer;
+};
+
+static bool hasImageExtension(const char* name) {
+	const char* dot = strrchr(name, '.');
+	return dot != NULL && (strcmp(dot, ".png") == 0 || strcmp(dot, ".jpg") == 0 || strcmp(dot, ".tga") == 0);
+}
+
+static void collectImages(const std::string& folder, std::vector<std::string>* paths) {
+	DIR* directory = opendir(folder.c_str());
+	if (directory == NULL) {
+		return;
+	}
+
+	struct dirent* item;
+	while ((item = readdir(directory)) != NULL) {
+		if (item->d_name[0] == '.') {
+			continue;
+		}
+
+		std::string path = folder + "/" + item->d_name;
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0) {
+			continue;
+		}
+
+		if (S_ISDIR(info.st_mode)) {
+			collectImages(path, paths);
+		}
+		else if (hasImageExtension(item->d_name)) {
+			paths->push_back(path);
+		}
+	}
+
+	closedir(directory);
+}
+
+static std::string labelFromPath(const std::string& path) {
+	size_t slash = path.find_last_of('/');
+	std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+	return name.substr(0, name.find_last_of('.'));
+}
+
+/* Shrinks the rect to the pixels with non-zero alpha. */
+static void trim(image_struct* image) {
+	int minX = image->sourceWidth, minY = image->sourceHeight, maxX = -1, maxY = -1;
+	for (int y = 0; y < image->sourceHeight; y++) {
+		for (int x = 0; x < image->sourceWidth; x++) {
+			if (image->pixels[(y * image->sourceWidth + x) * 4 + 3] != 0) {
+				minX = x < minX ? x : minX;
+				maxX = x > maxX ? x : maxX;
+				minY = y < minY ? y : minY;
+				maxY = y > maxY ? y : maxY;
+			}
+		}
+	}
+
+	if (maxX < 0) {
+		minX = minY = maxX = maxY = 0;
+	}
+
+	image->trimX = minX;
+	image->trimY = minY;
+	image->width = maxX - minX + 1;
+	image->height = maxY - minY + 1;
+}
+
+static bool tallerFirst(const image_struct& first, const image_struct& second) {
+	return first.height > second.height;
+}
+
+static void place(std::vector<page_struct>& pages, image_struct* image) {
+	for (size_t i = 0; i < pages.size(); i++) {
+		rect_packer::packer& packer = pages[i].packer;
+		while (true) {
+			if (rect_packer::insert(&packer, image->width, image->height, &image->x, &image->y)) {
+				image->page = (int) i;
+				return;
+			}
+			if (packer.width >= atlas_format::MAX_PAGE_SIZE) {
+				break;
+			}
+			rect_packer::grow(&packer, packer.width * 2, packer.height * 2);
+		}
+	}
+
+	int size = INITIAL_PAGE_SIZE;
+	int longest = (image->width > image->height ? image->width : image->height) + atlas_format::PADDING * 2;
+	while (size < longest) {
+		size *= 2;
+	}
+
+	page_struct page;
+	rect_packer::init(&page.packer, size, size, atlas_format::PADDING);
+	pages.push_back(page);
+
+	image->page = (int) pages.size() - 1;
+	rect_packer::insert(&pages.back().packer, image->width, image->height, &image->x, &image->y);
+}
+
+static void blit(unsigned char* page, int pageSize, const image_struct& image) {
+	int padding = atlas_format::PADDING;
+	for (int row = -padding; row < image.height + padding; row++) {
+		int sourceRow = row < 0 ? 0 : (row >= image.height ? image.height - 1 : row);
+		for (int column = -padding; column < image.width + padding; column++) {
+			int sourceColumn = column < 0 ? 0 : (column >= image.width ? image.width - 1 : column);
+			const unsigned char* source = image.pixels
+				+ ((image.trimY + sourceRow) * image.sourceWidth + image.trimX + sourceColumn) * 4;
+			memcpy(page + ((image.y + row) * pageSize + image.x + column) * 4, source, 4);
+		}
+	}
+}
+
+static bool writeTga(const std::string& path, const unsigned char* rgba, int size) {
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL) {
+		return false;
+	}
+
+	// uncompressed true-color, 32 bits, 8 alpha bits, top-left origin
+	unsigned char header[18] = {0};
+	header[2] = 2;
+	header[12] = size & 0xFF;
+	header[13] = (size >> 8) & 0xFF;
+	header[14] = size & 0xFF;
+	header[15] = (size >> 8) & 0xFF;
+	header[16] = 32;
+	header[17] = 0x28;
+	fwrite(header, 1, sizeof(header), file);
+
+	std::vector<unsigned char> row(size * 4);
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			const unsigned char* pixel = rgba + (y * size + x) * 4;
+			row[x * 4 + 0] = pixel[2];
+			row[x * 4 + 1] = pixel[1];
+			row[x * 4 + 2] = pixel[0];
+			row[x * 4 + 3] = pixel[3];
+		}
+		fwrite(&row[0], 1, row.size(), file);
+	}
+
+	fclose(file);
+	return true;
+}
+
+static void writeU8(std::vector<unsigned char>& out, int value) {
+	out.push_back((unsigned char) value);
+}
+
+static void writeU16(std::vector<unsigned char>& out, int value) {
+	out.push_back((unsigned char) (value & 0xFF));
+	out.push_back((unsigned char) ((value >> 8) & 0xFF));
+}
+
+static void writeString(std::vector<unsigned char>& out, const std::string& value) {
+	writeU8(out, (int) value.size());
+	out.insert(out.end(), value.begin(), value.end());
+}
+
+int main(int argc, char** argv) {
+	if (argc < 4) {
+		fprintf(stderr, "Usage: %s <assets folder> <output folder inside assets> <name>\n", argv[0]);
+		return 1;
+	}
+
+	std::string assets = argv[1];
+	std::string output = argv[2];
+	std::string name = argv[3];
+
+	std::vector<std::string> paths;
+	collectImages(assets + "/images/with_alpha", &paths);
+	collectImages(assets + "/images/no_alpha", &paths);
+
+	std::vector<image_struct> images;
+	long sourceArea = 0, trimmedArea = 0;
+	for (size_t i = 0; i < paths.size(); i++) {
+		image_struct image;
+		int channels;
+		image.label = labelFromPath(paths[i]);
+		image.pixels = stbi_load(paths[i].c_str(), &image.sourceWidth, &image.sourceHeight, &channels, 4);
+		if (image.pixels == NULL) {
+			fprintf(stderr, "Skipping %s: %s\n", paths[i].c_str(), stbi_failure_reason());
+			continue;
+		}
+		if (image.label.size() > 255 || image.sourceWidth > 0xFFFF || image.sourceHeight > 0xFFFF) {
+			fprintf(stderr, "Skipping %s: label or size out of range\n", paths[i].c_str());
+			stbi_image_free(image.pixels);
+			continue;
+		}
+
+		trim(&image);
+		sourceArea += (long) image.sourceWidth * image.sourceHeight;
+		trimmedArea += (long) image.width * image.height;
+		images.push_back(image);
+	}
+
+	std::sort(images.begin(), images.end(), tallerFirst);
+
+	std::vector<page_struct> pages;
+	for (size_t i = 0; i < images.size(); i++) {
+		if (images[i].width + atlas_format::PADDING * 2 > atlas_format::MAX_PAGE_SIZE
+			|| images[i].height + atlas_format::PADDING * 2 > atlas_format::MAX_PAGE_SIZE) {
+			fprintf(stderr, "%s doesn't fit into a %i page\n", images[i].label.c_str(), atlas_format::MAX_PAGE_SIZE);
+			return 1;
+		}
+		place(pages, &images[i]);
+	}
+
+	mkdir((assets + "/" + output).c_str(), 0755);
+
+	std::vector<unsigned char> index;
+	index.insert(index.end(), atlas_format::MAGIC, atlas_format::MAGIC + 4);
+	writeU16(index, atlas_format::VERSION);
+	writeU16(index, (int) pages.size());
+
+	for (size_t i = 0; i < pages.size(); i++) {
+		int size = pages[i].packer.width;
+		std::vector<unsigned char> pixels(size * size * 4, 0);
+		for (size_t j = 0; j < images.size(); j++) {
+			if (images[j].page == (int) i) {
+				blit(&pixels[0], size, images[j]);
+			}
+		}
+
+		char pageName[64];
+		snprintf(pageName, sizeof(pageName), "_%i.tga", (int) i);
+		std::string pagePath = output + "/" + name + pageName;
+		if (!writeTga(assets + "/" + pagePath, &pixels[0], size)) {
+			fprintf(stderr, "Could not write %s\n", pagePath.c_str());
+			return 1;
+		}
+
+		writeString(index, pagePath);
+		writeU16(index, size);
+		writeU16(index, size);
+
+		printf("%s: %ix%i, %.1f%% filled\n", pagePath.c_str(), size, size, rect_packer::fillRatio(&pages[i].packer) * 100);
+	}
+
+	writeU16(index, (int) images.size());
+	for (size_t i = 0; i < images.size(); i++) {
+		const image_struct& image = images[i];
+		writeString(index, image.label);
+		writeU16(index, image.page);
+		writeU16(index, image.x);
+		writeU16(index, image.y);
+		writeU16(index, image.width);
+		writeU16(index, image.height);
+		writeU16(index, image.sourceWidth);
+		writeU16(index, image.sourceHeight);
+		writeU16(index, image.trimX);
+		writeU16(index, image.trimY);
+
+		stbi_image_free(image.pixels);
+	}
+
+	std::string indexPath = assets + "/" + output + "/" + name + ".idx";
+	FILE* file = fopen(indexPath.c_str(), "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Could not write %s\n", indexPath.c_str());
+		return 1;
+	}
+	fwrite(&index[0], 1, index.size(), file);
+	fclose(file);
+
+	printf("%i images, trimming kept %.1f%% of the source pixels\n", (int) images.size(),
+		sourceArea > 0 ? trimmedArea * 100.0 / sourceArea : 0.0);
+
+	return 0;
+}
\ No newline at end of file
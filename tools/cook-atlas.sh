@@ -0,0 +1,4 @@
+#!/bin/sh
+# Builds the host atlas cooker and packs app/src/main/assets/images into app/src/main/assets/atlas
+cd "$(dirname "$0")/.."
+g++ -O2 -Iapp/src/main/jni/include tools/atlas_cooker.cpp app/src/main/jni/rect_packer.cpp -o tools/atlas_cooker && tools/atlas_cooker app/src/main/assets atlas sprites
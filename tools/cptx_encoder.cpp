@@ -0,0 +1,200 @@
+/**
+ * Host-side texture cooker. Converts every image found under the given files
+ * or folders into a .cptx next to it, in the format described in
+ * engine/cptx_format.h, so the engine uploads it without decoding anything.
+ * Pixels go through the engine's own pixel_convert, so they come out
+ * exactly as a runtime decode of the image would.
+ *
+ * Each image keeps the format cacheTexture would pick for it without a
+ * hint, unless --format names one. A full mip chain is stored, box filtered
+ * on the premultiplied pixels, unless --no-mips is given.
+ *
+ * Usage: cptx_encoder [--format name] [--no-mips] <image or folder>...
+ */
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <engine/cptx_format.h>
+#include <engine/pixel_convert.h>
+
+static bool hasImageExtension(const std::string& path) {
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos) {
+		return false;
+	}
+	std::string extension = path.substr(dot);
+	return extension == ".png" || extension == ".jpg" || extension == ".tga";
+}
+
+static void collectImages(const std::string& path, std::vector<std::string>* paths) {
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) {
+		return;
+	}
+
+	if (!S_ISDIR(info.st_mode)) {
+		if (hasImageExtension(path)) {
+			paths->push_back(path);
+		}
+		return;
+	}
+
+	DIR* directory = opendir(path.c_str());
+	if (directory == NULL) {
+		return;
+	}
+
+	struct dirent* item;
+	while ((item = readdir(directory)) != NULL) {
+		if (item->d_name[0] != '.') {
+			collectImages(path + "/" + item->d_name, paths);
+		}
+	}
+
+	closedir(directory);
+}
+
+static void putU32(unsigned char* out, unsigned int value) {
+	out[0] = (unsigned char) value;
+	out[1] = (unsigned char) (value >> 8);
+	out[2] = (unsigned char) (value >> 16);
+	out[3] = (unsigned char) (value >> 24);
+}
+
+/* Averages 2x2 blocks of premultiplied RGBA8; an odd last row or column is averaged with itself. */
+static void downsample(const unsigned char* source, int width, int height, unsigned char* out) {
+	int halfWidth = width > 1 ? width / 2 : 1;
+	int halfHeight = height > 1 ? height / 2 : 1;
+
+	for (int y = 0; y < halfHeight; y++) {
+		int y0 = y * 2 < height ? y * 2 : height - 1;
+		int y1 = y * 2 + 1 < height ? y * 2 + 1 : y0;
+		for (int x = 0; x < halfWidth; x++) {
+			int x0 = x * 2 < width ? x * 2 : width - 1;
+			int x1 = x * 2 + 1 < width ? x * 2 + 1 : x0;
+			for (int channel = 0; channel < 4; channel++) {
+				int sum = source[(y0 * width + x0) * 4 + channel] + source[(y0 * width + x1) * 4 + channel]
+					+ source[(y1 * width + x0) * 4 + channel] + source[(y1 * width + x1) * 4 + channel];
+				out[(y * halfWidth + x) * 4 + channel] = (unsigned char) ((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+static long alignUp(long value) {
+	return (value + cptx_format::ALIGNMENT - 1) / cptx_format::ALIGNMENT * cptx_format::ALIGNMENT;
+}
+
+static bool encode(const std::string& path, const char* formatHint, bool mips) {
+	int width, height, channels;
+	unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+	if (pixels == NULL) {
+		fprintf(stderr, "Skipping %s: %s\n", path.c_str(), stbi_failure_reason());
+		return false;
+	}
+
+	// the same steps decodeTexture takes after stb_image
+	int format = pixel_convert::formatFromHint(formatHint, channels);
+	int bpp = pixel_convert::bytesPerPixel(format);
+	if (channels == 2 || channels == 4) {
+		pixel_convert::premultiply(pixels, width, height);
+	}
+
+	std::vector<std::vector<unsigned char> > levels;
+	std::vector<unsigned char> rgba(pixels, pixels + (long) width * height * 4);
+	stbi_image_free(pixels);
+
+	int levelWidth = width, levelHeight = height;
+	while (true) {
+		levels.push_back(std::vector<unsigned char>((long) levelWidth * levelHeight * bpp));
+		pixel_convert::convert(&rgba[0], levelWidth, levelHeight, format, &levels.back()[0]);
+
+		if (!mips || (levelWidth == 1 && levelHeight == 1) || (int) levels.size() == cptx_format::MAX_LEVELS) {
+			break;
+		}
+
+		std::vector<unsigned char> smaller((long) (levelWidth > 1 ? levelWidth / 2 : 1) * (levelHeight > 1 ? levelHeight / 2 : 1) * 4);
+		downsample(&rgba[0], levelWidth, levelHeight, &smaller[0]);
+		rgba.swap(smaller);
+		levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+		levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+	}
+
+	std::vector<unsigned char> header(cptx_format::ALIGNMENT, 0);
+	memcpy(&header[0], cptx_format::MAGIC, sizeof(cptx_format::MAGIC));
+	unsigned int fields[cptx_format::HEADER_FIELDS] = {cptx_format::VERSION, (unsigned int) format, (unsigned int) channels,
+		(unsigned int) width, (unsigned int) height, (unsigned int) levels.size()};
+	for (int i = 0; i < cptx_format::HEADER_FIELDS; i++) {
+		putU32(&header[4 + i * 4], fields[i]);
+	}
+
+	long offset = cptx_format::ALIGNMENT;
+	for (size_t i = 0; i < levels.size(); i++) {
+		putU32(&header[4 + (cptx_format::HEADER_FIELDS + i * 2) * 4], (unsigned int) offset);
+		putU32(&header[4 + (cptx_format::HEADER_FIELDS + i * 2 + 1) * 4], (unsigned int) levels[i].size());
+		offset = alignUp(offset + (long) levels[i].size());
+	}
+
+	std::string output = path.substr(0, path.find_last_of('.')) + ".cptx";
+	FILE* file = fopen(output.c_str(), "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Could not write %s\n", output.c_str());
+		return false;
+	}
+
+	fwrite(&header[0], 1, header.size(), file);
+	long fileSize = (long) header.size();
+	for (size_t i = 0; i < levels.size(); i++) {
+		fwrite(&levels[i][0], 1, levels[i].size(), file);
+		fileSize += (long) levels[i].size();
+
+		// zero fill up to the next level, nothing follows the last one
+		if (i + 1 < levels.size()) {
+			for (; fileSize < alignUp(fileSize); fileSize++) {
+				fputc(0, file);
+			}
+		}
+	}
+	fclose(file);
+
+	printf("%s: %ix%i %s, %i levels, %li KB\n", output.c_str(), width, height, pixel_convert::formatName(format),
+		(int) levels.size(), fileSize / 1024);
+	return true;
+}
+
+int main(int argc, char** argv) {
+	const char* formatHint = NULL;
+	bool mips = true;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			formatHint = argv[++i];
+		}
+		else if (strcmp(argv[i], "--no-mips") == 0) {
+			mips = false;
+		}
+		else {
+			collectImages(argv[i], &paths);
+		}
+	}
+
+	if (paths.empty()) {
+		fprintf(stderr, "Usage: %s [--format rgba8|rgb8|rgb565|rgba4444|l8|la8] [--no-mips] <image or folder>...\n", argv[0]);
+		return 1;
+	}
+
+	int failed = 0;
+	for (size_t i = 0; i < paths.size(); i++) {
+		failed += encode(paths[i], formatHint, mips) ? 0 : 1;
+	}
+
+	return failed == 0 ? 0 : 1;
+}
\ No newline at end of file
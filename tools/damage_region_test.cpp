@@ -0,0 +1,259 @@
+/**
+ * Host test for damage_region. EGL is stubbed out below as a single window
+ * surface whose size, buffer age and extensions each test sets, and which
+ * records the rectangles handed to swap with damage. Checks that damage
+ * beyond MAX_RECTS is merged into the rectangles that grow least while still
+ * covering every change, that an age of 0 or one EGL can't report redraws
+ * everything, and that a back buffer older than the damage history falls
+ * back to the full surface.
+ *
+ * Usage: damage_region_test
+ */
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include <EGL/egl.h>
+
+#include <engine/damage_region.h>
+
+static const int WIDTH = 640, HEIGHT = 480;
+static const EGLint BUFFER_AGE = 0x313D;
+
+static const char* extensions = "";
+static EGLint surfaceWidth = WIDTH, surfaceHeight = HEIGHT;
+static EGLint bufferAge = 0;
+static bool ageKnown = true;
+
+static int plainSwaps = 0;
+static std::vector<EGLint> swappedDamage;
+
+static EGLBoolean swapWithDamage(EGLDisplay, EGLSurface, EGLint* rects, EGLint count) {
+	swappedDamage.assign(rects, rects + count * 4);
+	return EGL_TRUE;
+}
+
+const char* eglQueryString(EGLDisplay, EGLint name) {
+	return name == EGL_EXTENSIONS ? extensions : NULL;
+}
+
+__eglMustCastToProperFunctionPointerType eglGetProcAddress(const char* name) {
+	if (strcmp(name, "eglSwapBuffersWithDamageKHR") == 0) {
+		return (__eglMustCastToProperFunctionPointerType) swapWithDamage;
+	}
+	return NULL;
+}
+
+EGLBoolean eglQuerySurface(EGLDisplay, EGLSurface, EGLint attribute, EGLint* value) {
+	if (attribute == EGL_WIDTH) {
+		*value = surfaceWidth;
+	}
+	else if (attribute == EGL_HEIGHT) {
+		*value = surfaceHeight;
+	}
+	else if (attribute == BUFFER_AGE && ageKnown) {
+		*value = bufferAge;
+	}
+	else {
+		return EGL_FALSE;
+	}
+	return EGL_TRUE;
+}
+
+EGLBoolean eglSwapBuffers(EGLDisplay, EGLSurface) {
+	plainSwaps++;
+	return EGL_TRUE;
+}
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%i: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (0)
+
+/* A 16x16 sprite centred on x, y, tinted so a changed tint is a changed sprite. */
+static sprite_struct sprite(float x, float y, unsigned int tint) {
+	sprite_struct result = {1, {0, 0, 1, 1}, {-8, -8, 8, 8}, x, y, 0, 0, 1, tint};
+	return result;
+}
+
+static void setup(const char* extensionString) {
+	extensions = extensionString;
+	surfaceWidth = WIDTH;
+	surfaceHeight = HEIGHT;
+	bufferAge = 0;
+	ageKnown = true;
+	damage_region::init(EGL_NO_DISPLAY);
+}
+
+/* Runs one frame through the tracker with a camera mapping world units to window pixels. */
+static bool frame(const std::vector<sprite_struct>& sprites, int* scissor) {
+	static const float view[16] = {1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1};
+	float projection[16] = {2.0f / WIDTH,0,0,0, 0,2.0f / HEIGHT,0,0, 0,0,1,0, -1,-1,0,1};
+	static const float clear[3] = {0, 0, 0};
+
+	damage_region::beginFrame(EGL_NO_DISPLAY, EGL_NO_SURFACE, WIDTH, HEIGHT);
+	damage_region::setMatrices(projection, view);
+	damage_region::addClear(clear);
+	for (size_t i = 0; i < sprites.size(); i++) {
+		damage_region::add(sprites[i], i);
+	}
+	bool partial = damage_region::resolve(scissor);
+
+	plainSwaps = 0;
+	swappedDamage.clear();
+	damage_region::swap(EGL_NO_DISPLAY, EGL_NO_SURFACE);
+	return partial;
+}
+
+static bool covered(float x, float y) {
+	for (size_t i = 0; i < swappedDamage.size(); i += 4) {
+		if (x - 8 >= swappedDamage[i] && y - 8 >= swappedDamage[i + 1]
+			&& x + 8 <= swappedDamage[i] + swappedDamage[i + 2] && y + 8 <= swappedDamage[i + 1] + swappedDamage[i + 3]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool isFullSurface(const int* scissor) {
+	return scissor[0] == 0 && scissor[1] == 0 && scissor[2] == WIDTH && scissor[3] == HEIGHT;
+}
+
+static void testMergeCap() {
+	setup("EGL_KHR_swap_buffers_with_damage");
+	CHECK(damage_region::isTracking());
+
+	std::vector<sprite_struct> sprites;
+	for (int i = 0; i < 6; i++) {
+		sprites.push_back(sprite(40.0f + i * 100.0f, 40.0f + (i % 2) * 300.0f, 0xffffffff));
+	}
+	// a neighbour touching the first sprite
+	sprites.push_back(sprite(50.0f, 40.0f, 0xffffffff));
+
+	int scissor[4];
+	frame(sprites, scissor);
+	CHECK(plainSwaps == 1);
+
+	// two touching sprites merge into one rectangle
+	sprites[0].tint = 0xff0000ff;
+	sprites[6].tint = 0xff0000ff;
+	frame(sprites, scissor);
+	CHECK(plainSwaps == 0);
+	CHECK(swappedDamage.size() == 4);
+	CHECK(covered(40, 40) && covered(50, 40));
+	CHECK(swappedDamage[2] < 40 && swappedDamage[3] < 40);
+
+	// six far apart changes only get MAX_RECTS rectangles, which still cover all of them
+	for (int i = 0; i < 6; i++) {
+		sprites[i].tint = 0xff00ff00;
+	}
+	frame(sprites, scissor);
+	CHECK(swappedDamage.size() == 4 * 4);
+	for (int i = 0; i < 6; i++) {
+		CHECK(covered(sprites[i].x, sprites[i].y));
+	}
+
+	// nothing changed, nothing to hand the compositor
+	frame(sprites, scissor);
+	CHECK(plainSwaps == 1);
+}
+
+static void testUnknownAge() {
+	setup("EGL_EXT_buffer_age");
+
+	std::vector<sprite_struct> sprites;
+	sprites.push_back(sprite(100, 100, 0xffffffff));
+
+	int scissor[4];
+	bufferAge = 1;
+	CHECK(!frame(sprites, scissor));
+	CHECK(isFullSurface(scissor));
+
+	sprites[0].tint = 0xff0000ff;
+	CHECK(frame(sprites, scissor));
+	CHECK(scissor[2] < 40 && scissor[3] < 40);
+
+	// age 0 means the back buffer contents are undefined
+	bufferAge = 0;
+	sprites[0].tint = 0xff00ff00;
+	CHECK(!frame(sprites, scissor));
+	CHECK(isFullSurface(scissor));
+
+	// so does a query EGL refuses
+	bufferAge = 1;
+	ageKnown = false;
+	sprites[0].tint = 0xffff0000;
+	CHECK(!frame(sprites, scissor));
+	CHECK(isFullSurface(scissor));
+
+	// and without the extension there is no age at all
+	setup("");
+	CHECK(!damage_region::isTracking());
+	bufferAge = 1;
+	frame(sprites, scissor);
+	sprites[0].tint = 0xffffffff;
+	CHECK(!frame(sprites, scissor));
+	CHECK(isFullSurface(scissor));
+}
+
+static void testOldBuffer() {
+	setup("EGL_EXT_buffer_age");
+
+	std::vector<sprite_struct> sprites;
+	for (int i = 0; i < 8; i++) {
+		sprites.push_back(sprite(40.0f + i * 60.0f, 200.0f, 0xffffffff));
+	}
+
+	int scissor[4];
+	bufferAge = 1;
+	frame(sprites, scissor);
+
+	// one sprite changes per frame, filling the history
+	for (int i = 0; i < 6; i++) {
+		sprites[i].tint = 0xff0000ff;
+		CHECK(frame(sprites, scissor));
+	}
+
+	// a buffer two frames old redraws this frame's damage and the last one's
+	bufferAge = 2;
+	sprites[7].tint = 0xff0000ff;
+	CHECK(frame(sprites, scissor));
+	CHECK(scissor[0] <= 340 - 9 && scissor[0] + scissor[2] >= 460 + 9);
+	CHECK(scissor[0] > 280 + 9 && scissor[0] + scissor[2] < 520);
+
+	// the history holds four frames, so age 5 is the oldest buffer drawn into partially
+	bufferAge = 5;
+	sprites[1].tint = 0xff00ff00;
+	CHECK(frame(sprites, scissor));
+	CHECK(!isFullSurface(scissor));
+
+	bufferAge = 6;
+	sprites[2].tint = 0xff00ff00;
+	CHECK(!frame(sprites, scissor));
+	CHECK(isFullSurface(scissor));
+
+	// a resized surface forgets the history
+	bufferAge = 1;
+	surfaceWidth = WIDTH / 2;
+	sprites[3].tint = 0xff00ff00;
+	CHECK(!frame(sprites, scissor));
+	CHECK(scissor[2] == WIDTH / 2 && scissor[3] == HEIGHT);
+}
+
+int main() {
+	testMergeCap();
+	testUnknownAge();
+	testOldBuffer();
+
+	if (failures != 0) {
+		printf("damage_region_test: %i checks failed\n", failures);
+		return 1;
+	}
+	printf("damage_region_test: passed\n");
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+/**
+ * Host benchmark for cacheTextures. A batch of textures is decoded the way
+ * decodeJob does it (stb_image, premultiply, pixel_convert) once on this
+ * thread and once through worker_pool, collected with waitCompleted() in
+ * whatever order the workers finish. Prints both times and the worker
+ * count, and fails if a pooled decode differs from the serial one. The
+ * batch is the large textures from tools/host/png_corpus plus the PNGs
+ * given on the command line, or those in app/src/main/assets/images
+ * without any, each taken BATCH_COPIES times so every worker has work.
+ *
+ * The speedup depends on the cores of the machine it runs on; with one core
+ * both take the same time.
+ *
+ * Usage: decode_batch_bench [image or folder]...
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <engine/pixel_convert.h>
+#include <engine/worker_pool.h>
+
+#include "host/image_files.h"
+#include "host/png_corpus.h"
+
+static const int BATCH_COPIES = 4;
+
+struct decode_struct {
+	const png_corpus::file* file;
+	std::vector<unsigned char> pixels;
+	int format;
+};
+
+static double nowMillis() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+static void decode(void* argument) {
+	decode_struct* decode = (decode_struct*) argument;
+	int width, height, channels;
+	unsigned char* rgba = stbi_load_from_memory(&(*decode->file)[0], (int) decode->file->size(), &width, &height, &channels, 4);
+	if (rgba == NULL) {
+		return;
+	}
+
+	decode->format = pixel_convert::formatFromHint(NULL, channels);
+	if (channels == 2 || channels == 4) {
+		pixel_convert::premultiply(rgba, width, height);
+	}
+	decode->pixels.resize((long) width * height * pixel_convert::bytesPerPixel(decode->format));
+	pixel_convert::convert(rgba, width, height, decode->format, &decode->pixels[0]);
+	stbi_image_free(rgba);
+}
+
+int main(int argc, char** argv) {
+	std::vector<png_corpus::file> files;
+	png_corpus::large(&files);
+
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		image_files::collect(argv[i], ".png", &paths);
+	}
+	if (argc == 1) {
+		image_files::collect("app/src/main/assets/images", ".png", &paths);
+	}
+	for (size_t i = 0; i < paths.size(); i++) {
+		png_corpus::file file;
+		if (image_files::read(paths[i], &file)) {
+			files.push_back(file);
+		}
+	}
+
+	std::vector<decode_struct> serial, pooled;
+	for (int copy = 0; copy < BATCH_COPIES; copy++) {
+		for (size_t i = 0; i < files.size(); i++) {
+			decode_struct decode;
+			decode.file = &files[i];
+			decode.format = -1;
+			serial.push_back(decode);
+		}
+	}
+	pooled = serial;
+
+	double start = nowMillis();
+	for (size_t i = 0; i < serial.size(); i++) {
+		decode(&serial[i]);
+	}
+	double serialMillis = nowMillis() - start;
+
+	worker_pool::start();
+	start = nowMillis();
+	for (size_t i = 0; i < pooled.size(); i++) {
+		worker_pool::submit(decode, &pooled[i]);
+	}
+	int outOfOrder = 0;
+	long previous = -1;
+	for (size_t left = pooled.size(); left > 0; left--) {
+		void* completed;
+		worker_pool::waitCompleted(&completed);
+		long index = (decode_struct*) completed - &pooled[0];
+		outOfOrder += index < previous ? 1 : 0;
+		previous = index;
+	}
+	double pooledMillis = nowMillis() - start;
+	int workers = worker_pool::getWorkerCount();
+	worker_pool::stop();
+
+	int differences = 0;
+	for (size_t i = 0; i < serial.size(); i++) {
+		if (pooled[i].format != serial[i].format || pooled[i].pixels != serial[i].pixels) {
+			fprintf(stderr, "Decode %i differs from the serial one\n", (int) i);
+			differences++;
+		}
+	}
+
+	printf("%i decodes: serial %.1f ms, %i workers on %li cores %.1f ms, %.2fx, %i completed out of order\n", (int) serial.size(),
+		serialMillis, workers, sysconf(_SC_NPROCESSORS_ONLN), pooledMillis, serialMillis / pooledMillis, outOfOrder);
+	return differences == 0 ? 0 : 1;
+}
\ No newline at end of file
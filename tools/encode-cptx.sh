@@ -0,0 +1,5 @@
+#!/bin/sh
+# Builds the host texture cooker and writes a .cptx next to every image in app/src/main/assets/images
+cd "$(dirname "$0")/.."
+g++ -O2 -Iapp/src/main/jni/include tools/cptx_encoder.cpp app/src/main/jni/pixel_convert.cpp -o tools/cptx_encoder && tools/cptx_encoder "$@" app/src/main/assets/images
+
@@ -0,0 +1,4 @@
+#!/bin/sh
+# Builds the host ETC2 encoder and writes a .ktx next to every image in app/src/main/assets/images
+cd "$(dirname "$0")/.."
+g++ -O2 -Iapp/src/main/jni/include tools/ktx_encoder.cpp -o tools/ktx_encoder && tools/ktx_encoder app/src/main/assets/images "$@"
@@ -0,0 +1,166 @@
+/**
+ * Host test for frame_scheduler on a simulated clock, installed through
+ * setClock. Each frame does some work, then the display model swaps on the
+ * next vsync the swap interval allows and reports it with framePresented.
+ * Checks that timestamps only move forward and are the sum of whole-vsync
+ * deltas, that 60 and 30 fps keep their cadence and lock onto the swaps,
+ * that adaptive mode drops to 30 under load and comes back, and that a
+ * long pause is clamped instead of replayed.
+ *
+ * Usage: frame_scheduler_test
+ */
+#include <math.h>
+#include <stdio.h>
+
+#include <engine/frame_scheduler.h>
+
+static const double VSYNC = 1000.0 / 60.0;
+
+static double clockMillis = 1000.3;
+
+static double simulatedNow() {
+	return clockMillis;
+}
+
+static void simulatedSleep(double millis) {
+	clockMillis += millis;
+}
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%i: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (0)
+
+static double lastTimestamp = 0;
+static double summedDeltas = 0;
+
+struct run_struct {
+	int nonMonotonic;
+	int fractionalDeltas;
+	int driftedTimestamps;
+	double lastDelta;
+	int lastInterval;
+	// how long after the previous swap the last frame started
+	double lead;
+};
+
+/* Runs frames that each take workMillis of logic time and leave the swap to the display model. */
+static run_struct runFrames(int frames, double workMillis) {
+	run_struct run = {0, 0, 0, 0, 0, 0};
+	double lastPresent = 0;
+
+	for (int i = 0; i < frames; i++) {
+		double timestamp, delta;
+		frame_scheduler::beginFrame(&timestamp, &delta);
+
+		run.nonMonotonic += timestamp <= lastTimestamp;
+		double vsyncs = delta / VSYNC;
+		run.fractionalDeltas += fabs(vsyncs - floor(vsyncs + 0.5)) > 1e-9;
+		summedDeltas += delta;
+		run.driftedTimestamps += fabs(summedDeltas - timestamp) > 1e-6;
+		lastTimestamp = timestamp;
+
+		run.lead = lastPresent > 0 ? clockMillis - lastPresent : 0;
+
+		clockMillis += workMillis;
+		frame_scheduler::endFrame();
+
+		int interval = frame_scheduler::getSwapInterval();
+		double period = VSYNC * interval;
+		clockMillis = ceil(clockMillis / period) * period;
+		lastPresent = clockMillis;
+		frame_scheduler::framePresented(2.0);
+
+		run.lastDelta = delta;
+		run.lastInterval = interval;
+	}
+	return run;
+}
+
+static void testFixedRates() {
+	frame_scheduler::setFrameRate(60);
+	run_struct run = runFrames(300, 4.0);
+	CHECK(run.nonMonotonic == 0);
+	CHECK(run.fractionalDeltas == 0);
+	CHECK(run.driftedTimestamps == 0);
+	CHECK(run.lastInterval == 1);
+	CHECK(fabs(run.lastDelta - VSYNC) < 1e-9);
+	// locked on: frames start a millisecond after the swap, the scheduler's lead
+	CHECK(fabs(run.lead - 1.0) < 0.1);
+
+	int missedBefore;
+	float frameDelta, presentMillis;
+	frame_scheduler::getStats(&frameDelta, &presentMillis, &missedBefore);
+	runFrames(100, 4.0);
+	int missed;
+	frame_scheduler::getStats(&frameDelta, &presentMillis, &missed);
+	CHECK(missed == missedBefore);
+	CHECK(fabs(presentMillis - VSYNC) < 0.5);
+
+	frame_scheduler::setFrameRate(30);
+	run = runFrames(300, 4.0);
+	CHECK(run.nonMonotonic == 0);
+	CHECK(run.fractionalDeltas == 0);
+	CHECK(run.driftedTimestamps == 0);
+	CHECK(run.lastInterval == 2);
+	CHECK(fabs(run.lastDelta - VSYNC * 2) < 1e-9);
+	CHECK(fabs(run.lead - 1.0) < 0.1);
+}
+
+static void testAdaptive() {
+	frame_scheduler::setFrameRate(FRAME_RATE_ADAPTIVE);
+	run_struct run = runFrames(100, 4.0);
+	CHECK(run.lastInterval == 1);
+
+	// more work than a vsync holds
+	run = runFrames(150, 20.0);
+	CHECK(run.nonMonotonic == 0);
+	CHECK(run.fractionalDeltas == 0);
+	CHECK(run.lastInterval == 2);
+	CHECK(fabs(run.lastDelta - VSYNC * 2) < 1e-9);
+
+	run = runFrames(150, 4.0);
+	CHECK(run.nonMonotonic == 0);
+	CHECK(run.lastInterval == 1);
+	CHECK(fabs(run.lastDelta - VSYNC) < 1e-9);
+}
+
+static void testPause() {
+	frame_scheduler::setFrameRate(60);
+	runFrames(60, 4.0);
+
+	// the app was in the background for five seconds
+	clockMillis += 5000.0;
+	run_struct run = runFrames(1, 4.0);
+	CHECK(fabs(run.lastDelta - VSYNC * 6) < 1e-9);
+
+	run = runFrames(1, 4.0);
+	CHECK(run.lastDelta <= VSYNC * 2 + 1e-9);
+
+	run = runFrames(60, 4.0);
+	CHECK(run.nonMonotonic == 0);
+	CHECK(run.driftedTimestamps == 0);
+	CHECK(fabs(run.lastDelta - VSYNC) < 1e-9);
+}
+
+int main() {
+	frame_scheduler::setClock(simulatedNow, simulatedSleep);
+
+	testFixedRates();
+	testAdaptive();
+	testPause();
+
+	frame_scheduler::setClock(NULL, NULL);
+
+	if (failures != 0) {
+		printf("frame_scheduler_test: %i checks failed\n", failures);
+		return 1;
+	}
+	printf("frame_scheduler_test: passed\n");
+	return 0;
+}
@@ -0,0 +1,160 @@
+/**
+ * Host test for gl_state. Drives the shadow state on top of tools/host/stub_gl
+ * and checks that a call only reaches the driver when the value changes,
+ * that reset() and the forget* calls make the next call go through again,
+ * and that the issued and elided counters match what was sent.
+ *
+ * Usage: gl_state_test
+ */
+#include <stdio.h>
+
+#include <engine/gl_state.h>
+
+#include "host/stub_gl.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%i: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (0)
+
+static void testElision() {
+	stub_gl::reset();
+	gl_state::reset();
+	gl_state::endFrame();
+
+	gl_state::useProgram(3);
+	gl_state::useProgram(3);
+	gl_state::useProgram(4);
+	CHECK(stub_gl::calls("glUseProgram") == 2);
+
+	gl_state::bindTexture(0, 7);
+	gl_state::bindTexture(0, 7);
+	gl_state::bindTexture(1, 7);
+	gl_state::bindTexture(1, 8);
+	CHECK(stub_gl::calls("glBindTexture") == 3);
+	CHECK(stub_gl::calls("glActiveTexture") == 2);
+
+	// array and element bindings are tracked apart
+	gl_state::bindBuffer(GL_ARRAY_BUFFER, 5);
+	gl_state::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 5);
+	gl_state::bindBuffer(GL_ARRAY_BUFFER, 5);
+	CHECK(stub_gl::calls("glBindBuffer") == 2);
+
+	gl_state::enableVertexAttribArray(2);
+	gl_state::enableVertexAttribArray(2);
+	gl_state::enableVertexAttribArray(-1);
+	gl_state::disableVertexAttribArray(2);
+	gl_state::disableVertexAttribArray(2);
+	CHECK(stub_gl::calls("glEnableVertexAttribArray") == 1);
+	CHECK(stub_gl::calls("glDisableVertexAttribArray") == 1);
+
+	gl_state::vertexAttribDivisor(3, 1);
+	gl_state::vertexAttribDivisor(3, 1);
+	gl_state::vertexAttribDivisor(3, 0);
+	gl_state::vertexAttribDivisor(-1, 1);
+	CHECK(stub_gl::calls("glVertexAttribDivisor") == 2);
+
+	gl_state::setBlend(true);
+	gl_state::setBlend(true);
+	gl_state::setScissor(true);
+	gl_state::setScissor(false);
+	CHECK(stub_gl::calls("glEnable") == 2);
+	CHECK(stub_gl::calls("glDisable") == 1);
+
+	gl_state::blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state::blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state::blendFunc(GL_ONE, GL_ONE);
+	CHECK(stub_gl::calls("glBlendFunc") == 2);
+
+	gl_state::viewport(0, 0, 640, 480);
+	gl_state::viewport(0, 0, 640, 480);
+	gl_state::scissor(0, 0, 16, 16);
+	gl_state::scissor(0, 0, 16, 32);
+	CHECK(stub_gl::calls("glViewport") == 1);
+	CHECK(stub_gl::calls("glScissor") == 2);
+
+	gl_state::endFrame();
+	int issued, elided;
+	gl_state::getStats(&issued, &elided);
+	CHECK(issued == 19);
+	CHECK(elided == 9);
+}
+
+static void testUniforms() {
+	static const GLfloat identity[16] = {1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1};
+	static const GLfloat scaled[16] = {2,0,0,0, 0,2,0,0, 0,0,1,0, 0,0,0,1};
+
+	stub_gl::reset();
+	gl_state::reset();
+
+	GLint first = gl_state::uniformLocation(1, "u_Projection");
+	CHECK(gl_state::uniformLocation(1, "u_Projection") == first);
+	gl_state::uniformLocation(2, "u_Projection");
+	gl_state::attribLocation(1, "a_Position");
+	gl_state::attribLocation(1, "a_Position");
+	CHECK(stub_gl::calls("glGetUniformLocation") == 2);
+	CHECK(stub_gl::calls("glGetAttribLocation") == 1);
+
+	// matrices are remembered per program
+	gl_state::useProgram(1);
+	gl_state::uniformMatrix4(first, identity);
+	gl_state::uniformMatrix4(first, identity);
+	gl_state::useProgram(2);
+	gl_state::uniformMatrix4(first, identity);
+	gl_state::useProgram(1);
+	gl_state::uniformMatrix4(first, identity);
+	gl_state::uniformMatrix4(first, scaled);
+	gl_state::uniformMatrix4(-1, scaled);
+	CHECK(stub_gl::calls("glUniformMatrix4fv") == 3);
+
+	// a recreated program reusing the name starts from nothing
+	gl_state::forgetProgram(1);
+	gl_state::uniformLocation(1, "u_Projection");
+	gl_state::useProgram(1);
+	gl_state::uniformMatrix4(first, scaled);
+	CHECK(stub_gl::calls("glGetUniformLocation") == 3);
+	CHECK(stub_gl::calls("glUseProgram") == 4);
+	CHECK(stub_gl::calls("glUniformMatrix4fv") == 4);
+}
+
+static void testForget() {
+	stub_gl::reset();
+	gl_state::reset();
+
+	gl_state::bindTexture(0, 7);
+	gl_state::forgetTexture(7);
+	gl_state::bindTexture(0, 0);
+	gl_state::bindTexture(0, 7);
+	CHECK(stub_gl::calls("glBindTexture") == 2);
+
+	gl_state::bindBuffer(GL_ARRAY_BUFFER, 5);
+	gl_state::forgetBuffer(5);
+	gl_state::bindBuffer(GL_ARRAY_BUFFER, 5);
+	CHECK(stub_gl::calls("glBindBuffer") == 2);
+
+	// a fresh context may hold anything, so the first call after reset always goes through
+	gl_state::useProgram(0);
+	gl_state::reset();
+	gl_state::useProgram(0);
+	gl_state::viewport(0, 0, 640, 480);
+	CHECK(stub_gl::calls("glUseProgram") == 2);
+	CHECK(stub_gl::calls("glViewport") == 1);
+}
+
+int main() {
+	testElision();
+	testUniforms();
+	testForget();
+
+	if (failures != 0) {
+		printf("gl_state_test: %i checks failed\n", failures);
+		return 1;
+	}
+	printf("gl_state_test: passed\n");
+	return 0;
+}
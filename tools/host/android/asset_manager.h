@@ -0,0 +1,38 @@
+#ifndef CHICKPEA_HOST_ANDROID_ASSET_MANAGER_H
+#define CHICKPEA_HOST_ANDROID_ASSET_MANAGER_H
+
+#include <sys/types.h>
+
+/* Host stand-in for the NDK header, the calls are served from a folder by tools/host/host_assets.cpp. */
+
+extern "C" {
+
+struct AAssetManager;
+struct AAsset;
+
+enum {
+	AASSET_MODE_UNKNOWN = 0,
+	AASSET_MODE_RANDOM = 1,
+	AASSET_MODE_STREAMING = 2,
+	AASSET_MODE_BUFFER = 3
+};
+
+AAsset* AAssetManager_open(AAssetManager*, const char*, int);
+
+int AAsset_read(AAsset*, void*, size_t);
+
+off_t AAsset_seek(AAsset*, off_t, int);
+
+void AAsset_close(AAsset*);
+
+const void* AAsset_getBuffer(AAsset*);
+
+off_t AAsset_getLength(AAsset*);
+
+off_t AAsset_getRemainingLength(AAsset*);
+
+int AAsset_openFileDescriptor(AAsset*, off_t*, off_t*);
+
+}
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef CHICKPEA_HOST_ANDROID_LOG_H
+#define CHICKPEA_HOST_ANDROID_LOG_H
+
+/* Host stand-in for the NDK header, so engine sources build with g++ under tools/. Logging is dropped. */
+
+enum {
+	ANDROID_LOG_INFO = 4,
+	ANDROID_LOG_WARN = 5,
+	ANDROID_LOG_ERROR = 6
+};
+
+static inline int __android_log_print(int, const char*, const char*, ...) {
+	return 0;
+}
+
+#endif
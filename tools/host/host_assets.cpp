@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+
+#include "host_assets.h"
+
+struct AAsset {
+	FILE* file;
+	long length;
+	void* buffer;
+	bool compressed;
+};
+
+namespace host_assets {
+
+	static bool compressed = false;
+	static int openCount = 0;
+
+	AAssetManager* open(const char* root) {
+		return (AAssetManager*) root;
+	}
+
+	void setCompressed(bool value) {
+		compressed = value;
+	}
+
+	int openAssets() {
+		return openCount;
+	}
+
+}
+
+extern "C" {
+
+AAsset* AAssetManager_open(AAssetManager* manager, const char* path, int) {
+	std::string fullPath = std::string((const char*) manager) + "/" + path;
+	FILE* file = fopen(fullPath.c_str(), "rb");
+	if (file == NULL) {
+		return NULL;
+	}
+
+	AAsset* asset = new AAsset();
+	asset->file = file;
+	fseek(file, 0, SEEK_END);
+	asset->length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	asset->buffer = NULL;
+	asset->compressed = host_assets::compressed;
+	host_assets::openCount++;
+	return asset;
+}
+
+int AAsset_read(AAsset* asset, void* data, size_t size) {
+	return (int) fread(data, 1, size, asset->file);
+}
+
+off_t AAsset_seek(AAsset* asset, off_t offset, int whence) {
+	fseek(asset->file, offset, whence);
+	return ftell(asset->file);
+}
+
+void AAsset_close(AAsset* asset) {
+	fclose(asset->file);
+	free(asset->buffer);
+	delete asset;
+	host_assets::openCount--;
+}
+
+const void* AAsset_getBuffer(AAsset* asset) {
+	if (asset->buffer == NULL) {
+		asset->buffer = malloc(asset->length);
+		fseek(asset->file, 0, SEEK_SET);
+		if (fread(asset->buffer, 1, asset->length, asset->file) != (size_t) asset->length) {
+			free(asset->buffer);
+			asset->buffer = NULL;
+		}
+	}
+	return asset->buffer;
+}
+
+off_t AAsset_getLength(AAsset* asset) {
+	return asset->length;
+}
+
+off_t AAsset_getRemainingLength(AAsset* asset) {
+	return asset->length - ftell(asset->file);
+}
+
+int AAsset_openFileDescriptor(AAsset* asset, off_t* start, off_t* length) {
+	if (asset->compressed) {
+		return -1;
+	}
+	*start = 0;
+	*length = asset->length;
+	return dup(fileno(asset->file));
+}
+
+}
@@ -0,0 +1,23 @@
+#ifndef CHICKPEA_HOST_HOST_ASSETS_H
+#define CHICKPEA_HOST_HOST_ASSETS_H
+
+#include <android/asset_manager.h>
+
+/**
+ * A folder standing in for the APK behind the AAsset calls. Assets are
+ * either stored, which hands out a file descriptor and maps the file, or
+ * compressed, which refuses the descriptor like a deflated APK entry does.
+ * Mapped buffers come from plain malloc, so allocation counters placed
+ * around stb_image never see them, just as they wouldn't see an mmap.
+ */
+namespace host_assets {
+
+	AAssetManager* open(const char*);
+
+	void setCompressed(bool);
+
+	int openAssets();
+
+}
+
+#endif
@@ -0,0 +1,65 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include "image_files.h"
+
+namespace image_files {
+
+	static bool hasExtension(const std::string& path, const char* extension) {
+		size_t dot = path.find_last_of('.');
+		return dot != std::string::npos && path.compare(dot, std::string::npos, extension) == 0;
+	}
+
+	void collect(const std::string& path, const char* extension, std::vector<std::string>* paths) {
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0) {
+			return;
+		}
+
+		if (!S_ISDIR(info.st_mode)) {
+			if (hasExtension(path, extension)) {
+				paths->push_back(path);
+			}
+			return;
+		}
+
+		DIR* directory = opendir(path.c_str());
+		if (directory == NULL) {
+			return;
+		}
+
+		// readdir order depends on the file system, runs should be comparable
+		std::vector<std::string> names;
+		struct dirent* item;
+		while ((item = readdir(directory)) != NULL) {
+			if (item->d_name[0] != '.') {
+				names.push_back(item->d_name);
+			}
+		}
+		closedir(directory);
+
+		std::sort(names.begin(), names.end());
+		for (size_t i = 0; i < names.size(); i++) {
+			collect(path + "/" + names[i], extension, paths);
+		}
+	}
+
+	bool read(const std::string& path, std::vector<unsigned char>* data) {
+		FILE* file = fopen(path.c_str(), "rb");
+		if (file == NULL) {
+			return false;
+		}
+
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		data->resize(size);
+		bool complete = size > 0 && fread(&(*data)[0], 1, size, file) == (size_t) size;
+		fclose(file);
+		return complete;
+	}
+
+}
@@ -0,0 +1,20 @@
+#ifndef CHICKPEA_HOST_IMAGE_FILES_H
+#define CHICKPEA_HOST_IMAGE_FILES_H
+
+#include <string>
+#include <vector>
+
+/**
+ * File helpers shared by the host benchmarks: every image under a set of
+ * files or folders, in a stable order, and whole files read into memory
+ * the way the engine sees a mapped asset.
+ */
+namespace image_files {
+
+	void collect(const std::string&, const char*, std::vector<std::string>*);
+
+	bool read(const std::string&, std::vector<unsigned char>*);
+
+}
+
+#endif
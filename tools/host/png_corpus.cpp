@@ -0,0 +1,161 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include "png_corpus.h"
+
+namespace png_corpus {
+
+	// filter type 5 is not a PNG filter, it asks for a random one on every row
+	static const int MIXED_FILTERS = 5;
+
+	static unsigned int nextRandom(unsigned int* state) {
+		*state = *state * 1103515245u + 12345u;
+		return *state >> 8;
+	}
+
+	static void putU32(file* out, unsigned int value) {
+		out->push_back((unsigned char) (value >> 24));
+		out->push_back((unsigned char) (value >> 16));
+		out->push_back((unsigned char) (value >> 8));
+		out->push_back((unsigned char) value);
+	}
+
+	static void putChunk(file* out, const char* type, const file& data) {
+		putU32(out, (unsigned int) data.size());
+		size_t start = out->size();
+		out->insert(out->end(), type, type + 4);
+		out->insert(out->end(), data.begin(), data.end());
+		putU32(out, (unsigned int) crc32(0, &(*out)[start], (unsigned int) (out->size() - start)));
+	}
+
+	static int channelCount(int colorType) {
+		switch (colorType) {
+			case 0: return 1;
+			case 2: return 3;
+			case 3: return 1;
+			case 4: return 2;
+			default: return 4;
+		}
+	}
+
+	static int paeth(int a, int b, int c) {
+		int p = a + b - c;
+		int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+		return pa <= pb && pa <= pc ? a : (pb <= pc ? b : c);
+	}
+
+	/* Filters raw rows the way an encoder would, so decoding has to undo exactly that. */
+	static void filterRow(int filter, const unsigned char* row, const unsigned char* previous, int bytes, int pixelBytes, file* out) {
+		out->push_back((unsigned char) filter);
+		for (int i = 0; i < bytes; i++) {
+			int left = i >= pixelBytes ? row[i - pixelBytes] : 0;
+			int up = previous != NULL ? previous[i] : 0;
+			int upLeft = previous != NULL && i >= pixelBytes ? previous[i - pixelBytes] : 0;
+			int predicted = 0;
+			switch (filter) {
+				case 1: predicted = left; break;
+				case 2: predicted = up; break;
+				case 3: predicted = (left + up) / 2; break;
+				case 4: predicted = paeth(left, up, upLeft); break;
+			}
+			out->push_back((unsigned char) (row[i] - predicted));
+		}
+	}
+
+	/* content 0 is noise, 1 a gradient, 2 a few repeated values; depth is 8 or 16. */
+	static file encode(int width, int height, int colorType, int depth, int filter, int content, int level, unsigned int* state) {
+		int pixelBytes = channelCount(colorType) * depth / 8;
+		int rowBytes = width * pixelBytes;
+
+		std::vector<unsigned char> pixels((size_t) rowBytes * height);
+		static const unsigned char FEW[] = {0, 1, 2, 128, 255};
+		for (size_t i = 0; i < pixels.size(); i++) {
+			int x = (int) (i % rowBytes), y = (int) (i / rowBytes);
+			switch (content) {
+				case 0: pixels[i] = (unsigned char) nextRandom(state); break;
+				case 1: pixels[i] = (unsigned char) (x * 7 + y * 3 + (nextRandom(state) & 3)); break;
+				default: pixels[i] = FEW[nextRandom(state) % sizeof(FEW)]; break;
+			}
+		}
+		if (colorType == 3) {
+			for (size_t i = 0; i < pixels.size(); i++) {
+				pixels[i] %= 16;
+			}
+		}
+
+		file filtered;
+		for (int y = 0; y < height; y++) {
+			int rowFilter = filter == MIXED_FILTERS ? (int) (nextRandom(state) % 5) : filter;
+			filterRow(rowFilter, &pixels[(size_t) y * rowBytes], y > 0 ? &pixels[(size_t) (y - 1) * rowBytes] : NULL, rowBytes, pixelBytes, &filtered);
+		}
+
+		uLongf compressedSize = compressBound((uLong) filtered.size());
+		file compressed(compressedSize);
+		compress2(&compressed[0], &compressedSize, &filtered[0], (uLong) filtered.size(), level);
+		compressed.resize(compressedSize);
+
+		static const unsigned char SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+		file out(SIGNATURE, SIGNATURE + 8);
+
+		file header;
+		putU32(&header, (unsigned int) width);
+		putU32(&header, (unsigned int) height);
+		header.push_back((unsigned char) depth);
+		header.push_back((unsigned char) colorType);
+		header.push_back(0);
+		header.push_back(0);
+		header.push_back(0);
+		putChunk(&out, "IHDR", header);
+
+		if (colorType == 3) {
+			file palette;
+			for (int i = 0; i < 16 * 3; i++) {
+				palette.push_back((unsigned char) (i * 37));
+			}
+			putChunk(&out, "PLTE", palette);
+		}
+
+		putChunk(&out, "IDAT", compressed);
+		putChunk(&out, "IEND", file());
+		return out;
+	}
+
+	void small(std::vector<file>* files) {
+		static const int COLOR_TYPES[] = {0, 2, 3, 4, 6};
+		static const int WIDTHS[] = {1, 2, 3, 4, 5, 7, 8, 15, 16, 17, 33, 100, 257};
+		static const int HEIGHTS[] = {1, 2, 9};
+		static const int LEVELS[] = {0, 1, 6, 9};
+
+		unsigned int state = 7;
+		for (int type = 0; type < 5; type++) {
+			int colorType = COLOR_TYPES[type];
+			for (int depth = 8; depth <= 16; depth += 8) {
+				if (colorType == 3 && depth == 16) {
+					continue;
+				}
+				for (int w = 0; w < (int) (sizeof(WIDTHS) / sizeof(WIDTHS[0])); w++) {
+					for (int h = 0; h < 3; h++) {
+						for (int filter = 0; filter <= MIXED_FILTERS; filter++) {
+							int content = (int) (nextRandom(&state) % 3);
+							int level = LEVELS[nextRandom(&state) % 4];
+							files->push_back(encode(WIDTHS[w], HEIGHTS[h], colorType, depth, filter, content, level, &state));
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void large(std::vector<file>* files) {
+		unsigned int state = 11;
+		// the formats textures actually come in: RGBA and RGB, filtered the way encoders pick
+		for (int i = 0; i < 4; i++) {
+			files->push_back(encode(1024, 1024, i % 2 == 0 ? 6 : 2, 8, MIXED_FILTERS, 1, 6, &state));
+		}
+		files->push_back(encode(1024, 1024, 6, 8, 4, 1, 9, &state));
+		files->push_back(encode(1024, 1024, 6, 8, 1, 2, 6, &state));
+	}
+
+}
\ No newline at end of file
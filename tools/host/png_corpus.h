@@ -0,0 +1,23 @@
+#ifndef CHICKPEA_HOST_PNG_CORPUS_H
+#define CHICKPEA_HOST_PNG_CORPUS_H
+
+#include <vector>
+
+/**
+ * PNG files generated in memory with zlib for the stb_image checks. small()
+ * covers every color type and bit depth stb_image reads, widths around each
+ * SIMD step, every filter type on its own and mixed per row, and every
+ * zlib level from stored blocks up. large() is a handful of big textures for
+ * timing, as noisy as real art so inflate and the filters both show up.
+ */
+namespace png_corpus {
+
+	typedef std::vector<unsigned char> file;
+
+	void small(std::vector<file>*);
+
+	void large(std::vector<file>*);
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,21 @@
+// only the loader is used, the rest of the static API would warn about every other function
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_SIMD
+#include "stb_image.h"
+
+#include "stb_reference.h"
+
+namespace stb_reference {
+
+	unsigned char* load(const unsigned char* data, int size, int* width, int* height, int* channels, int requested) {
+		return stbi_load_from_memory(data, size, width, height, channels, requested);
+	}
+
+	void free(void* image) {
+		stbi_image_free(image);
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#ifndef CHICKPEA_HOST_STB_REFERENCE_H
+#define CHICKPEA_HOST_STB_REFERENCE_H
+
+/**
+ * stb_image built with STBI_NO_SIMD, which leaves out both the SIMD
+ * unfiltering and the fast inflate, so it decodes the way the library did
+ * before either. Linked next to the normal build to compare the two.
+ */
+namespace stb_reference {
+
+	unsigned char* load(const unsigned char*, int, int*, int*, int*, int);
+
+	void free(void*);
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+
+#include <GLES3/gl3.h>
+
+#include "stub_gl.h"
+
+namespace stub_gl {
+
+	static std::map<std::string, int> counts;
+	static int total = 0;
+
+	static const char* extensions = "";
+	static GLenum framebufferStatus = GL_FRAMEBUFFER_COMPLETE;
+
+	static void count(const char* name) {
+		counts[name]++;
+		total++;
+	}
+
+	void reset() {
+		counts.clear();
+		total = 0;
+		extensions = "";
+		framebufferStatus = GL_FRAMEBUFFER_COMPLETE;
+	}
+
+	void setExtensions(const char* value) {
+		extensions = value;
+	}
+
+	void setFramebufferStatus(GLenum value) {
+		framebufferStatus = value;
+	}
+
+	const char* getExtensions() {
+		return extensions;
+	}
+
+	GLenum getFramebufferStatus() {
+		return framebufferStatus;
+	}
+
+	int calls(const char* name) {
+		std::map<std::string, int>::iterator found = counts.find(name);
+		return found != counts.end() ? found->second : 0;
+	}
+
+	int totalCalls() {
+		return total;
+	}
+
+	static unsigned char* mapped = NULL;
+	static GLsizeiptr mappedSize = 0;
+	static GLuint nextName = 1;
+	static GLint nextLocation = 0;
+
+	void* map(GLsizeiptr size) {
+		if (size > mappedSize) {
+			mapped = (unsigned char*) realloc(mapped, size);
+			mappedSize = size;
+		}
+		return mapped;
+	}
+
+	GLuint generate() {
+		return nextName++;
+	}
+
+	GLint location() {
+		return nextLocation++;
+	}
+
+}
+
+#define COUNT stub_gl::count(__func__)
+
+extern "C" {
+
+void glActiveTexture(GLenum) { COUNT; }
+void glBindBuffer(GLenum, GLuint) { COUNT; }
+void glBindFramebuffer(GLenum, GLuint) { COUNT; }
+void glBindTexture(GLenum, GLuint) { COUNT; }
+void glBlendFunc(GLenum, GLenum) { COUNT; }
+void glBufferData(GLenum, GLsizeiptr, const void*, GLenum) { COUNT; }
+void glBufferSubData(GLenum, GLintptr, GLsizeiptr, const void*) { COUNT; }
+GLenum glCheckFramebufferStatus(GLenum) { COUNT; return stub_gl::getFramebufferStatus(); }
+void glClear(GLbitfield) { COUNT; }
+void glClearColor(GLfloat, GLfloat, GLfloat, GLfloat) { COUNT; }
+GLenum glClientWaitSync(GLsync, GLbitfield, GLuint64) { COUNT; return GL_ALREADY_SIGNALED; }
+void glCompressedTexImage2D(GLenum, GLint, GLenum, GLsizei, GLsizei, GLint, GLsizei, const void*) { COUNT; }
+void glCopyTexSubImage2D(GLenum, GLint, GLint, GLint, GLint, GLint, GLsizei, GLsizei) { COUNT; }
+void glDeleteBuffers(GLsizei, const GLuint*) { COUNT; }
+void glDeleteFramebuffers(GLsizei, const GLuint*) { COUNT; }
+void glDeleteSync(GLsync) { COUNT; }
+void glDeleteTextures(GLsizei, const GLuint*) { COUNT; }
+void glDisable(GLenum) { COUNT; }
+void glDisableVertexAttribArray(GLuint) { COUNT; }
+void glDrawElements(GLenum, GLsizei, GLenum, const void*) { COUNT; }
+void glDrawElementsInstanced(GLenum, GLsizei, GLenum, const void*, GLsizei) { COUNT; }
+void glEnable(GLenum) { COUNT; }
+void glEnableVertexAttribArray(GLuint) { COUNT; }
+GLsync glFenceSync(GLenum, GLbitfield) { COUNT; return (GLsync) 1; }
+void glFramebufferTexture2D(GLenum, GLenum, GLenum, GLuint, GLint) { COUNT; }
+void glGenBuffers(GLsizei n, GLuint* buffers) { COUNT; for (int i = 0; i < n; i++) buffers[i] = stub_gl::generate(); }
+void glGenFramebuffers(GLsizei n, GLuint* framebuffers) { COUNT; for (int i = 0; i < n; i++) framebuffers[i] = stub_gl::generate(); }
+void glGenTextures(GLsizei n, GLuint* textures) { COUNT; for (int i = 0; i < n; i++) textures[i] = stub_gl::generate(); }
+GLint glGetAttribLocation(GLuint, const GLchar*) { COUNT; return stub_gl::location(); }
+GLenum glGetError() { COUNT; return GL_NO_ERROR; }
+void glGetIntegerv(GLenum, GLint* data) { COUNT; *data = 4096; }
+const GLubyte* glGetString(GLenum name) { COUNT; return (const GLubyte*) (name == GL_EXTENSIONS ? stub_gl::getExtensions() : ""); }
+GLint glGetUniformLocation(GLuint, const GLchar*) { COUNT; return stub_gl::location(); }
+void* glMapBufferRange(GLenum, GLintptr, GLsizeiptr length, GLbitfield) { COUNT; return stub_gl::map(length); }
+void glPixelStorei(GLenum, GLint) { COUNT; }
+void glScissor(GLint, GLint, GLsizei, GLsizei) { COUNT; }
+void glTexImage2D(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*) { COUNT; }
+void glTexParameteri(GLenum, GLenum, GLint) { COUNT; }
+void glTexSubImage2D(GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void*) { COUNT; }
+void glUniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat*) { COUNT; }
+GLboolean glUnmapBuffer(GLenum) { COUNT; return GL_TRUE; }
+void glUseProgram(GLuint) { COUNT; }
+void glVertexAttribDivisor(GLuint, GLuint) { COUNT; }
+void glVertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) { COUNT; }
+void glViewport(GLint, GLint, GLsizei, GLsizei) { COUNT; }
+
+}
@@ -0,0 +1,27 @@
+#ifndef CHICKPEA_HOST_STUB_GL_H
+#define CHICKPEA_HOST_STUB_GL_H
+
+#include <GLES3/gl3.h>
+
+/**
+ * A GLES3 implementation that draws nothing and counts every call, so the
+ * engine's GL code runs in host benchmarks and tests. Buffers can be
+ * mapped, syncs are always signalled and locations are handed out in
+ * order. The extension string and framebuffer status can be set, reset()
+ * goes back to no extensions and complete framebuffers.
+ */
+namespace stub_gl {
+
+	void reset();
+
+	int calls(const char*);
+
+	int totalCalls();
+
+	void setExtensions(const char*);
+
+	void setFramebufferStatus(GLenum);
+
+}
+
+#endif
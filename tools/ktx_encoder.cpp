@@ -0,0 +1,401 @@
+/**
+ * Host-side ETC2 encoder. Converts every image found under the given files or
+ * folders into a .ktx next to it, in the format described in
+ * engine/ktx_format.h. Opaque images become RGB8_ETC2 (4 bits per pixel),
+ * anything with alpha is premultiplied and becomes RGBA8_ETC2_EAC (8 bits
+ * per pixel).
+ *
+ * Color blocks only use the ETC1 individual and differential modes, which
+ * every ETC2 decoder accepts; the search is exhaustive over tables and
+ * flips but not over base colors, so quality is fine for sprites rather
+ * than state of the art.
+ *
+ * Usage: ktx_encoder <image or folder>...
+ */
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <engine/ktx_format.h>
+
+static const int ETC_MODIFIERS[8][2] = {
+	{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}
+};
+
+static const int EAC_MODIFIERS[16][8] = {
+	{-3, -6, -9, -15, 2, 5, 8, 14},
+	{-3, -7, -10, -13, 2, 6, 9, 12},
+	{-2, -5, -8, -13, 1, 4, 7, 12},
+	{-2, -4, -6, -13, 1, 3, 5, 12},
+	{-3, -6, -8, -12, 2, 5, 7, 11},
+	{-3, -7, -9, -11, 2, 6, 8, 10},
+	{-4, -7, -8, -11, 3, 6, 7, 10},
+	{-3, -5, -8, -11, 2, 4, 7, 10},
+	{-2, -6, -8, -10, 1, 5, 7, 9},
+	{-2, -5, -8, -10, 1, 4, 7, 9},
+	{-2, -4, -8, -10, 1, 3, 7, 9},
+	{-2, -5, -7, -10, 1, 4, 6, 9},
+	{-3, -4, -7, -10, 2, 3, 6, 9},
+	{-1, -2, -3, -10, 0, 1, 2, 9},
+	{-4, -6, -8, -9, 3, 5, 7, 8},
+	{-3, -5, -7, -9, 2, 4, 6, 8}
+};
+
+static inline int clamp255(int value) {
+	return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+/* Pixels of a 4x4 block are numbered column by column, as in the ETC spec. */
+struct block_struct {
+	int rgba[16][4];
+};
+
+struct subblock_result {
+	long error;
+	int table;
+	int indices[16];
+};
+
+/* Picks the modifier table and per-pixel indices for one half of a block. */
+static subblock_result encodeSubblock(const block_struct& block, const bool* member, const int* base) {
+	subblock_result best;
+	best.error = LONG_MAX;
+
+	for (int table = 0; table < 8; table++) {
+		subblock_result candidate;
+		candidate.error = 0;
+		candidate.table = table;
+
+		for (int pixel = 0; pixel < 16; pixel++) {
+			if (!member[pixel]) {
+				continue;
+			}
+
+			long pixelBest = LONG_MAX;
+			for (int index = 0; index < 4; index++) {
+				int modifier = ETC_MODIFIERS[table][index & 1];
+				if (index & 2) {
+					modifier = -modifier;
+				}
+
+				long error = 0;
+				for (int channel = 0; channel < 3; channel++) {
+					int difference = clamp255(base[channel] + modifier) - block.rgba[pixel][channel];
+					error += difference * difference;
+				}
+				if (error < pixelBest) {
+					pixelBest = error;
+					candidate.indices[pixel] = index;
+				}
+			}
+			candidate.error += pixelBest;
+		}
+
+		if (candidate.error < best.error) {
+			best = candidate;
+		}
+	}
+
+	return best;
+}
+
+static inline int expand4(int value) {
+	return (value << 4) | value;
+}
+
+static inline int expand5(int value) {
+	return (value << 3) | (value >> 2);
+}
+
+static void writeBigEndian(unsigned char* out, unsigned long long bits) {
+	for (int i = 0; i < 8; i++) {
+		out[i] = (unsigned char) (bits >> (56 - i * 8));
+	}
+}
+
+static void encodeColor(const block_struct& block, unsigned char* out) {
+	long bestError = LONG_MAX;
+	unsigned long long bestBits = 0;
+
+	for (int flip = 0; flip < 2; flip++) {
+		bool members[2][16];
+		int average[2][3] = {{0, 0, 0}, {0, 0, 0}};
+		for (int pixel = 0; pixel < 16; pixel++) {
+			int x = pixel / 4, y = pixel % 4;
+			int half = flip ? (y >= 2) : (x >= 2);
+			members[half][pixel] = true;
+			members[1 - half][pixel] = false;
+			for (int channel = 0; channel < 3; channel++) {
+				average[half][channel] += block.rgba[pixel][channel];
+			}
+		}
+
+		for (int differential = 0; differential < 2; differential++) {
+			int quantized[2][3], base[2][3];
+			bool valid = true;
+			for (int half = 0; half < 2; half++) {
+				for (int channel = 0; channel < 3; channel++) {
+					int value = average[half][channel] / 8;
+					if (differential) {
+						quantized[half][channel] = (value * 31 + 127) / 255;
+						base[half][channel] = expand5(quantized[half][channel]);
+					}
+					else {
+						quantized[half][channel] = (value * 15 + 127) / 255;
+						base[half][channel] = expand4(quantized[half][channel]);
+					}
+				}
+			}
+
+			if (differential) {
+				for (int channel = 0; channel < 3; channel++) {
+					int delta = quantized[1][channel] - quantized[0][channel];
+					valid = valid && delta >= -4 && delta <= 3;
+				}
+			}
+			if (!valid) {
+				continue;
+			}
+
+			subblock_result first = encodeSubblock(block, members[0], base[0]);
+			subblock_result second = encodeSubblock(block, members[1], base[1]);
+			long error = first.error + second.error;
+			if (error >= bestError) {
+				continue;
+			}
+
+			unsigned long long bits = 0;
+			for (int channel = 0; channel < 3; channel++) {
+				int shift = 56 - channel * 8;
+				if (differential) {
+					int delta = (quantized[1][channel] - quantized[0][channel]) & 0x7;
+					bits |= (unsigned long long) ((quantized[0][channel] << 3) | delta) << shift;
+				}
+				else {
+					bits |= (unsigned long long) ((quantized[0][channel] << 4) | quantized[1][channel]) << shift;
+				}
+			}
+			bits |= (unsigned long long) first.table << 37;
+			bits |= (unsigned long long) second.table << 34;
+			bits |= (unsigned long long) differential << 33;
+			bits |= (unsigned long long) flip << 32;
+
+			for (int pixel = 0; pixel < 16; pixel++) {
+				int index = members[0][pixel] ? first.indices[pixel] : second.indices[pixel];
+				bits |= (unsigned long long) ((index >> 1) & 1) << (16 + pixel);
+				bits |= (unsigned long long) (index & 1) << pixel;
+			}
+
+			bestError = error;
+			bestBits = bits;
+		}
+	}
+
+	writeBigEndian(out, bestBits);
+}
+
+static void encodeAlpha(const block_struct& block, unsigned char* out) {
+	int minimum = 255, maximum = 0;
+	for (int pixel = 0; pixel < 16; pixel++) {
+		int alpha = block.rgba[pixel][3];
+		minimum = alpha < minimum ? alpha : minimum;
+		maximum = alpha > maximum ? alpha : maximum;
+	}
+
+	long bestError = LONG_MAX;
+	unsigned long long bestBits = 0;
+
+	for (int table = 0; table < 16; table++) {
+		const int* modifiers = EAC_MODIFIERS[table];
+		int span = modifiers[7] - modifiers[3];
+		int guess = (maximum - minimum + span / 2) / span;
+
+		for (int multiplier = guess - 1; multiplier <= guess + 1; multiplier++) {
+			if (multiplier < 1 || multiplier > 15) {
+				continue;
+			}
+
+			int middle = (minimum + maximum) / 2;
+			for (int base = middle - 8; base <= middle + 8; base++) {
+				if (base < 0 || base > 255) {
+					continue;
+				}
+
+				long error = 0;
+				unsigned long long indices = 0;
+				for (int pixel = 0; pixel < 16 && error < bestError; pixel++) {
+					long pixelBest = LONG_MAX;
+					int pixelIndex = 0;
+					for (int index = 0; index < 8; index++) {
+						int difference = clamp255(base + modifiers[index] * multiplier) - block.rgba[pixel][3];
+						if (difference * difference < pixelBest) {
+							pixelBest = difference * difference;
+							pixelIndex = index;
+						}
+					}
+					error += pixelBest;
+					indices |= (unsigned long long) pixelIndex << (45 - pixel * 3);
+				}
+
+				if (error < bestError) {
+					bestError = error;
+					bestBits = ((unsigned long long) base << 56)
+						| ((unsigned long long) multiplier << 52)
+						| ((unsigned long long) table << 48)
+						| indices;
+				}
+			}
+		}
+	}
+
+	writeBigEndian(out, bestBits);
+}
+
+static bool hasImageExtension(const std::string& path) {
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos) {
+		return false;
+	}
+	std::string extension = path.substr(dot);
+	return extension == ".png" || extension == ".jpg" || extension == ".tga";
+}
+
+static void collectImages(const std::string& path, std::vector<std::string>* paths) {
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) {
+		return;
+	}
+
+	if (!S_ISDIR(info.st_mode)) {
+		if (hasImageExtension(path)) {
+			paths->push_back(path);
+		}
+		return;
+	}
+
+	DIR* directory = opendir(path.c_str());
+	if (directory == NULL) {
+		return;
+	}
+
+	struct dirent* item;
+	while ((item = readdir(directory)) != NULL) {
+		if (item->d_name[0] != '.') {
+			collectImages(path + "/" + item->d_name, paths);
+		}
+	}
+
+	closedir(directory);
+}
+
+static void writeU32(FILE* file, unsigned int value) {
+	fwrite(&value, sizeof(value), 1, file);
+}
+
+static bool encode(const std::string& path) {
+	int width, height, channels;
+	unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+	if (pixels == NULL) {
+		fprintf(stderr, "Skipping %s: %s\n", path.c_str(), stbi_failure_reason());
+		return false;
+	}
+
+	bool opaque = true;
+	for (int i = 0; i < width * height && opaque; i++) {
+		opaque = pixels[i * 4 + 3] == 255;
+	}
+
+	// the engine blends premultiplied, same rounding as pixel_convert::premultiply
+	if (!opaque) {
+		for (int i = 0; i < width * height; i++) {
+			unsigned char* pixel = pixels + i * 4;
+			for (int channel = 0; channel < 3; channel++) {
+				int product = pixel[channel] * pixel[3] + 128;
+				pixel[channel] = (unsigned char) ((product + (product >> 8)) >> 8);
+			}
+		}
+	}
+
+	int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	int blockBytes = opaque ? 8 : 16;
+	std::vector<unsigned char> data(blocksX * blocksY * blockBytes);
+
+	for (int blockY = 0; blockY < blocksY; blockY++) {
+		for (int blockX = 0; blockX < blocksX; blockX++) {
+			// edge blocks repeat the last row and column
+			block_struct block;
+			for (int pixel = 0; pixel < 16; pixel++) {
+				int x = blockX * 4 + pixel / 4, y = blockY * 4 + pixel % 4;
+				x = x < width ? x : width - 1;
+				y = y < height ? y : height - 1;
+				for (int channel = 0; channel < 4; channel++) {
+					block.rgba[pixel][channel] = pixels[(y * width + x) * 4 + channel];
+				}
+			}
+
+			unsigned char* out = &data[(blockY * blocksX + blockX) * blockBytes];
+			if (!opaque) {
+				encodeAlpha(block, out);
+				out += 8;
+			}
+			encodeColor(block, out);
+		}
+	}
+	stbi_image_free(pixels);
+
+	std::string output = path.substr(0, path.find_last_of('.')) + ".ktx";
+	FILE* file = fopen(output.c_str(), "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Could not write %s\n", output.c_str());
+		return false;
+	}
+
+	fwrite(ktx_format::IDENTIFIER, 1, sizeof(ktx_format::IDENTIFIER), file);
+	writeU32(file, ktx_format::ENDIANNESS);
+	writeU32(file, 0);
+	writeU32(file, 1);
+	writeU32(file, 0);
+	writeU32(file, opaque ? ktx_format::COMPRESSED_RGB8_ETC2 : ktx_format::COMPRESSED_RGBA8_ETC2_EAC);
+	writeU32(file, opaque ? ktx_format::RGB : ktx_format::RGBA);
+	writeU32(file, width);
+	writeU32(file, height);
+	writeU32(file, 0);
+	writeU32(file, 0);
+	writeU32(file, 1);
+	writeU32(file, 1);
+	writeU32(file, 0);
+	writeU32(file, (unsigned int) data.size());
+	fwrite(&data[0], 1, data.size(), file);
+	fclose(file);
+
+	printf("%s: %ix%i %s, %i KB instead of %i KB\n", output.c_str(), width, height, opaque ? "RGB8_ETC2" : "RGBA8_ETC2_EAC",
+		(int) data.size() / 1024, width * height * 4 / 1024);
+	return true;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <image or folder>...\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		collectImages(argv[i], &paths);
+	}
+
+	int failed = 0;
+	for (size_t i = 0; i < paths.size(); i++) {
+		failed += encode(paths[i]) ? 0 : 1;
+	}
+
+	return failed == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,187 @@
+/**
+ * Host test for pixel_convert. Checks premultiply and every convert()
+ * format against the scalar reference below, bit for bit. Widths run from
+ * 1 to 70 so every SIMD kernel is seen with each possible tail, several
+ * rows deep so every row of the dither matrix is hit, and the output is
+ * followed by guard bytes that a kernel running past the row would change.
+ * premultiply is also checked for every color and alpha pair.
+ *
+ * Built with the host compiler's defaults, which on x86 means the SSE2
+ * kernels; the NEON ones are covered when this is built for ARM.
+ *
+ * Usage: pixel_convert_test
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <engine/pixel_convert.h>
+
+static const int GUARD = 64;
+static const unsigned char GUARD_BYTE = 0xA5;
+
+static const unsigned char BAYER[4][4] = {
+	{0, 8, 2, 10},
+	{12, 4, 14, 6},
+	{3, 11, 1, 9},
+	{15, 7, 13, 5}
+};
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%i: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (0)
+
+static int saturate(int value) {
+	return value > 255 ? 255 : value;
+}
+
+static unsigned char referencePremultiply(int value, int alpha) {
+	return (unsigned char) ((value * alpha) / 255.0 + 0.5);
+}
+
+/* Writes one pixel of the given format the way the documented conversion defines it. */
+static void referencePixel(const unsigned char* p, int format, int x, int y, unsigned char* out) {
+	int dither = BAYER[y & 3][x & 3];
+	unsigned short packed;
+	switch (format) {
+		case PIXEL_RGB8:
+			memcpy(out, p, 3);
+			break;
+		case PIXEL_RGB565:
+			packed = (unsigned short) (((saturate(p[0] + (dither >> 1)) & 0xF8) << 8)
+				| ((saturate(p[1] + (dither >> 2)) & 0xFC) << 3)
+				| (saturate(p[2] + (dither >> 1)) >> 3));
+			memcpy(out, &packed, 2);
+			break;
+		case PIXEL_RGBA4444:
+			packed = (unsigned short) (((saturate(p[0] + dither) & 0xF0) << 8)
+				| ((saturate(p[1] + dither) & 0xF0) << 4)
+				| (saturate(p[2] + dither) & 0xF0)
+				| (saturate(p[3] + dither) >> 4));
+			memcpy(out, &packed, 2);
+			break;
+		case PIXEL_L8:
+			out[0] = p[0];
+			break;
+		case PIXEL_LA8:
+			out[0] = p[0];
+			out[1] = p[3];
+			break;
+		default:
+			memcpy(out, p, 4);
+			break;
+	}
+}
+
+static void randomPixels(std::vector<unsigned char>* pixels) {
+	for (size_t i = 0; i < pixels->size(); i++) {
+		// plenty of values near the top so the dither saturates
+		(*pixels)[i] = (unsigned char) (rand() % 4 == 0 ? 250 + rand() % 6 : rand());
+	}
+}
+
+static void testAllPairs() {
+	std::vector<unsigned char> rgba(256 * 256 * 4);
+	for (int alpha = 0; alpha < 256; alpha++) {
+		for (int value = 0; value < 256; value++) {
+			unsigned char* pixel = &rgba[(alpha * 256 + value) * 4];
+			pixel[0] = (unsigned char) value;
+			pixel[1] = (unsigned char) (255 - value);
+			pixel[2] = (unsigned char) (value ^ 0x5A);
+			pixel[3] = (unsigned char) alpha;
+		}
+	}
+	std::vector<unsigned char> source = rgba;
+	pixel_convert::premultiply(&rgba[0], 256, 256);
+
+	int mismatches = 0;
+	for (size_t i = 0; i < rgba.size(); i += 4) {
+		for (int channel = 0; channel < 3; channel++) {
+			mismatches += rgba[i + channel] != referencePremultiply(source[i + channel], source[i + 3]);
+		}
+		mismatches += rgba[i + 3] != source[i + 3];
+	}
+	CHECK(mismatches == 0);
+}
+
+static void testPremultiplyTails() {
+	for (int width = 1; width <= 70; width++) {
+		int height = 5;
+		int count = width * height;
+		std::vector<unsigned char> rgba(count * 4 + GUARD, GUARD_BYTE);
+		std::vector<unsigned char> source(count * 4);
+		randomPixels(&source);
+		memcpy(&rgba[0], &source[0], source.size());
+
+		pixel_convert::premultiply(&rgba[0], width, height);
+
+		int mismatches = 0;
+		for (int i = 0; i < count; i++) {
+			for (int channel = 0; channel < 3; channel++) {
+				mismatches += rgba[i * 4 + channel] != referencePremultiply(source[i * 4 + channel], source[i * 4 + 3]);
+			}
+			mismatches += rgba[i * 4 + 3] != source[i * 4 + 3];
+		}
+		for (int i = 0; i < GUARD; i++) {
+			mismatches += rgba[count * 4 + i] != GUARD_BYTE;
+		}
+		if (mismatches != 0) {
+			fprintf(stderr, "premultiply width %i: %i bytes differ\n", width, mismatches);
+		}
+		CHECK(mismatches == 0);
+	}
+}
+
+static void testConvertTails() {
+	for (int format = PIXEL_RGBA8; format <= PIXEL_LA8; format++) {
+		int bpp = pixel_convert::bytesPerPixel(format);
+		for (int width = 1; width <= 70; width++) {
+			int height = 6;
+			std::vector<unsigned char> rgba(width * height * 4);
+			randomPixels(&rgba);
+
+			int bytes = width * height * bpp;
+			std::vector<unsigned char> out(bytes + GUARD, GUARD_BYTE);
+			std::vector<unsigned char> expected(bytes);
+			pixel_convert::convert(&rgba[0], width, height, format, &out[0]);
+			for (int y = 0; y < height; y++) {
+				for (int x = 0; x < width; x++) {
+					referencePixel(&rgba[(y * width + x) * 4], format, x, y, &expected[(y * width + x) * bpp]);
+				}
+			}
+
+			int mismatches = 0;
+			for (int i = 0; i < bytes; i++) {
+				mismatches += out[i] != expected[i];
+			}
+			for (int i = 0; i < GUARD; i++) {
+				mismatches += out[bytes + i] != GUARD_BYTE;
+			}
+			if (mismatches != 0) {
+				fprintf(stderr, "%s width %i: %i bytes differ\n", pixel_convert::formatName(format), width, mismatches);
+			}
+			CHECK(mismatches == 0);
+		}
+	}
+}
+
+int main() {
+	srand(1);
+	testAllPairs();
+	testPremultiplyTails();
+	testConvertTails();
+
+	if (failures != 0) {
+		printf("pixel_convert_test: %i checks failed\n", failures);
+		return 1;
+	}
+	printf("pixel_convert_test: passed\n");
+	return 0;
+}
@@ -0,0 +1,86 @@
+/**
+ * Host benchmark for PNG decoding. Every file is decoded to RGBA, the way
+ * decodeTexture asks for it, once with stb_image as the engine builds it
+ * and once with tools/host/stb_reference, the scalar inflate and unfilter
+ * it replaced. Covers the large textures from tools/host/png_corpus plus
+ * the PNGs given on the command line, or those in app/src/main/assets/images
+ * without any. tools/png_identity_check makes sure both decode the same.
+ *
+ * Usage: png_decode_bench [image or folder]...
+ */
+#include <stdio.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "host/image_files.h"
+#include "host/png_corpus.h"
+#include "host/stb_reference.h"
+
+static const int DECODES = 10;
+
+static double nowMillis() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+int main(int argc, char** argv) {
+	std::vector<png_corpus::file> files;
+	std::vector<std::string> names;
+	png_corpus::large(&files);
+	for (size_t i = 0; i < files.size(); i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "generated #%i", (int) i);
+		names.push_back(name);
+	}
+
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		image_files::collect(argv[i], ".png", &paths);
+	}
+	if (argc == 1) {
+		image_files::collect("app/src/main/assets/images", ".png", &paths);
+	}
+	for (size_t i = 0; i < paths.size(); i++) {
+		png_corpus::file file;
+		if (image_files::read(paths[i], &file)) {
+			files.push_back(file);
+			names.push_back(paths[i]);
+		}
+	}
+
+	double total = 0, totalReference = 0;
+	for (size_t i = 0; i < files.size(); i++) {
+		const png_corpus::file& file = files[i];
+		int width = 0, height = 0, channels = 0;
+		stbi_info_from_memory(&file[0], (int) file.size(), &width, &height, &channels);
+
+		double millis = 0;
+		for (int decode = 0; decode < DECODES; decode++) {
+			double start = nowMillis();
+			unsigned char* image = stbi_load_from_memory(&file[0], (int) file.size(), &width, &height, NULL, 4);
+			millis += nowMillis() - start;
+			stbi_image_free(image);
+		}
+
+		double referenceMillis = 0;
+		for (int decode = 0; decode < DECODES; decode++) {
+			double start = nowMillis();
+			unsigned char* image = stb_reference::load(&file[0], (int) file.size(), &width, &height, NULL, 4);
+			referenceMillis += nowMillis() - start;
+			stb_reference::free(image);
+		}
+
+		printf("%-50s %4ix%-4i %i channels: %8.3f ms, reference %8.3f ms, %4.2fx\n", names[i].c_str(), width, height, channels,
+			millis / DECODES, referenceMillis / DECODES, referenceMillis / millis);
+		total += millis / DECODES;
+		totalReference += referenceMillis / DECODES;
+	}
+
+	printf("all %i files: %.3f ms, reference %.3f ms per decode, %.2fx\n", (int) files.size(), total, totalReference, totalReference / total);
+	return 0;
+}
\ No newline at end of file
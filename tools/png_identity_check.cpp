@@ -0,0 +1,81 @@
+/**
+ * Checks that stb_image as the engine builds it decodes PNGs byte for byte
+ * like the scalar code it replaced (tools/host/stb_reference, the same
+ * header with STBI_NO_SIMD). Covers the generated corpus from
+ * tools/host/png_corpus plus the PNGs given on the command line, or those
+ * in app/src/main/assets/images without any, each decoded to its own
+ * channel count and to every forced one, since RGB widened to RGBA takes
+ * its own unfilter path.
+ *
+ * Usage: png_identity_check [image or folder]...
+ */
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "host/image_files.h"
+#include "host/png_corpus.h"
+#include "host/stb_reference.h"
+
+/* Returns the number of decodes that differ. */
+static int compare(const png_corpus::file& file, const std::string& name) {
+	int differences = 0;
+	for (int requested = 0; requested <= 4; requested++) {
+		int width, height, channels;
+		unsigned char* image = stbi_load_from_memory(&file[0], (int) file.size(), &width, &height, &channels, requested);
+		int referenceWidth, referenceHeight, referenceChannels;
+		unsigned char* reference = stb_reference::load(&file[0], (int) file.size(), &referenceWidth, &referenceHeight, &referenceChannels, requested);
+
+		bool same = (image == NULL) == (reference == NULL);
+		if (same && image != NULL) {
+			same = width == referenceWidth && height == referenceHeight && channels == referenceChannels
+				&& memcmp(image, reference, (size_t) width * height * (requested != 0 ? requested : channels)) == 0;
+		}
+		if (!same) {
+			fprintf(stderr, "%s decoded to %i channels differs from the reference\n", name.c_str(), requested);
+			differences++;
+		}
+
+		stbi_image_free(image);
+		stb_reference::free(reference);
+	}
+	return differences;
+}
+
+int main(int argc, char** argv) {
+	std::vector<png_corpus::file> files;
+	png_corpus::small(&files);
+	png_corpus::large(&files);
+
+	int differences = 0;
+	for (size_t i = 0; i < files.size(); i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "generated #%i", (int) i);
+		differences += compare(files[i], name);
+	}
+
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		image_files::collect(argv[i], ".png", &paths);
+	}
+	if (argc == 1) {
+		image_files::collect("app/src/main/assets/images", ".png", &paths);
+	}
+	for (size_t i = 0; i < paths.size(); i++) {
+		png_corpus::file file;
+		if (image_files::read(paths[i], &file)) {
+			differences += compare(file, paths[i]);
+		}
+	}
+
+	if (differences != 0) {
+		printf("png_identity_check: %i of %i decodes differ\n", differences, (int) (files.size() + paths.size()) * 5);
+		return 1;
+	}
+	printf("png_identity_check: %i files identical\n", (int) (files.size() + paths.size()));
+	return 0;
+}
\ No newline at end of file
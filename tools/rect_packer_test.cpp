@@ -0,0 +1,175 @@
+/**
+ * Host test for rect_packer. Fills pages with rects of mixed sizes and checks
+ * that no two padded rects overlap and all stay inside the page, that rects
+ * which can't fit are rejected without disturbing the skyline, that every
+ * rect keeps its padding as a gutter to the page edge and its neighbours, and
+ * that the UV rects texture_atlas derives from the placements are normalised
+ * to the page, also after the page grows.
+ *
+ * Usage: rect_packer_test
+ */
+#include <stdio.h>
+#include <vector>
+
+#include <engine/rect_packer.h>
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%i: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (0)
+
+struct placement {
+	int x, y, width, height;
+};
+
+static unsigned int seed = 12345;
+
+static int nextSize(int limit) {
+	seed = seed * 1103515245 + 12345;
+	return 1 + (int) ((seed >> 16) % limit);
+}
+
+/* Tries attempts rects of random size and keeps the ones that fit. */
+static void fill(rect_packer::packer* packer, int attempts, int maxSize, std::vector<placement>* placed) {
+	for (int i = 0; i < attempts; i++) {
+		placement rect = {0, 0, nextSize(maxSize), nextSize(maxSize)};
+		if (rect_packer::insert(packer, rect.width, rect.height, &rect.x, &rect.y)) {
+			placed->push_back(rect);
+		}
+	}
+}
+
+static bool overlap(const placement& a, const placement& b, int padding) {
+	return a.x - padding < b.x + b.width + padding && b.x - padding < a.x + a.width + padding
+		&& a.y - padding < b.y + b.height + padding && b.y - padding < a.y + a.height + padding;
+}
+
+static void checkPlacements(const rect_packer::packer& packer, const std::vector<placement>& placed) {
+	int padding = packer.padding;
+	long area = 0;
+	for (size_t i = 0; i < placed.size(); i++) {
+		const placement& rect = placed[i];
+		CHECK(rect.x - padding >= 0 && rect.y - padding >= 0);
+		CHECK(rect.x + rect.width + padding <= packer.width);
+		CHECK(rect.y + rect.height + padding <= packer.height);
+		for (size_t j = i + 1; j < placed.size(); j++) {
+			if (overlap(rect, placed[j], padding)) {
+				fprintf(stderr, "rects %i and %i overlap\n", (int) i, (int) j);
+				failures++;
+			}
+		}
+		area += (long) (rect.width + padding * 2) * (rect.height + padding * 2);
+	}
+	CHECK(packer.usedArea == area);
+}
+
+static void testNoOverlap() {
+	int paddings[] = {0, 1, 2};
+	for (int p = 0; p < 3; p++) {
+		rect_packer::packer packer;
+		rect_packer::init(&packer, 256, 256, paddings[p]);
+
+		std::vector<placement> placed;
+		fill(&packer, 500, 40, &placed);
+		CHECK(placed.size() > 20);
+		checkPlacements(packer, placed);
+		CHECK(rect_packer::fillRatio(&packer) > 0.5f && rect_packer::fillRatio(&packer) <= 1.0f);
+	}
+}
+
+static void testOutOfBounds() {
+	rect_packer::packer packer;
+	rect_packer::init(&packer, 64, 64, 1);
+	int x, y;
+
+	// the padding counts against the page, so 63 pixels no longer fit
+	CHECK(!rect_packer::insert(&packer, 63, 8, &x, &y));
+	CHECK(!rect_packer::insert(&packer, 8, 63, &x, &y));
+	CHECK(!rect_packer::insert(&packer, 100, 100, &x, &y));
+	CHECK(packer.usedArea == 0);
+	CHECK(packer.skyline.size() == 1 && packer.skyline[0].y == 0 && packer.skyline[0].width == 64);
+
+	CHECK(rect_packer::insert(&packer, 62, 40, &x, &y));
+	CHECK(x == 1 && y == 1);
+
+	// 22 rows are left, the gutter takes two of them
+	CHECK(!rect_packer::insert(&packer, 8, 21, &x, &y));
+	CHECK(rect_packer::insert(&packer, 8, 20, &x, &y));
+	CHECK(x == 1 && y == 43);
+}
+
+static void testGutter() {
+	rect_packer::packer packer;
+	int x, y;
+
+	// without padding rects sit flush against each other
+	rect_packer::init(&packer, 64, 64, 0);
+	CHECK(rect_packer::insert(&packer, 16, 16, &x, &y));
+	CHECK(x == 0 && y == 0);
+	CHECK(rect_packer::insert(&packer, 16, 16, &x, &y));
+	CHECK(x == 16 && y == 0);
+
+	// with it, each rect owns padding pixels on every side for texture_atlas to repeat its border into
+	rect_packer::init(&packer, 64, 64, 2);
+	CHECK(rect_packer::insert(&packer, 16, 16, &x, &y));
+	CHECK(x == 2 && y == 2);
+	CHECK(rect_packer::insert(&packer, 16, 16, &x, &y));
+	CHECK(x == 2 + 16 + 4 && y == 2);
+	CHECK(packer.usedArea == 2 * 20 * 20);
+
+	// the skyline sits on top of the lower gutter, so a wide rect goes above both
+	CHECK(rect_packer::insert(&packer, 50, 8, &x, &y));
+	CHECK(x == 2 && y == 2 + 16 + 4);
+}
+
+static void testUVs() {
+	rect_packer::packer packer;
+	rect_packer::init(&packer, 128, 128, 1);
+
+	std::vector<placement> placed;
+	fill(&packer, 200, 30, &placed);
+	CHECK(!placed.empty());
+
+	for (int pass = 0; pass < 2; pass++) {
+		float width = (float) packer.width;
+		float height = (float) packer.height;
+		for (size_t i = 0; i < placed.size(); i++) {
+			// the same arithmetic as texture_atlas::lookup
+			const placement& rect = placed[i];
+			float u0 = rect.x / width, v0 = rect.y / height;
+			float u1 = (rect.x + rect.width) / width, v1 = (rect.y + rect.height) / height;
+			CHECK(u0 > 0.0f && v0 > 0.0f && u1 < 1.0f && v1 < 1.0f);
+			CHECK(u0 < u1 && v0 < v1);
+			CHECK((u1 - u0) * width == (float) rect.width);
+			CHECK((v1 - v0) * height == (float) rect.height);
+		}
+
+		// texture_atlas grows a full page in place, placements keep their pixels
+		rect_packer::grow(&packer, 256, 256);
+	}
+
+	CHECK(packer.width == 256 && packer.height == 256);
+	size_t before = placed.size();
+	fill(&packer, 200, 30, &placed);
+	CHECK(placed.size() > before);
+	checkPlacements(packer, placed);
+}
+
+int main() {
+	testNoOverlap();
+	testOutOfBounds();
+	testGutter();
+	testUVs();
+
+	if (failures != 0) {
+		printf("rect_packer_test: %i checks failed\n", failures);
+		return 1;
+	}
+	printf("rect_packer_test: passed\n");
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,243 @@
+/**
+ * Host test for render_queue. Records frames, executes them into a
+ * sprite_batch stand-in that remembers the order sprites arrive in, and
+ * checks that order against std::stable_sort over the documented keys:
+ * submission order inside plain layers, texture then back to front inside
+ * sorted ones, ties in submission order, and no command leaving its camera
+ * segment. Also prints what the radix sort costs per 10k commands.
+ *
+ * render_thread and damage_region are stubbed out below; the queue only
+ * needs a slot back from publish and damage tracking switched off.
+ *
+ * Usage: render_queue_test
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <engine/render_queue.h>
+#include <engine/render_thread.h>
+#include <engine/damage_region.h>
+#include <engine/sprite_batch.h>
+
+static std::vector<unsigned int> drawn;
+static std::vector<int> drawnSegment;
+static int segment = 0;
+
+namespace sprite_batch {
+
+	void setMatrices(const float*, const float*) {
+		segment++;
+	}
+
+	void add(const sprite_struct& sprite) {
+		drawn.push_back(sprite.tint);
+		drawnSegment.push_back(segment);
+	}
+
+	void flush() {
+	}
+
+}
+
+namespace render_thread {
+
+	int publish(int slot) {
+		return (slot + 1) % SLOT_COUNT;
+	}
+
+}
+
+namespace damage_region {
+
+	bool isTracking() {
+		return false;
+	}
+
+	void setMatrices(const float*, const float*) {
+	}
+
+	void addClear(const float*) {
+	}
+
+	void add(const sprite_struct&, uint64_t) {
+	}
+
+	bool resolve(int*) {
+		return false;
+	}
+
+}
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%i: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (0)
+
+static const float identity[16] = {1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1};
+
+struct submitted_struct {
+	unsigned int id;
+	int layer;
+	int segment;
+	GLuint texture;
+	float z;
+};
+
+static bool sortedLayer[256];
+
+/* The order the key layout in render_queue.cpp promises, for a stable sort. */
+static bool drawsBefore(const submitted_struct& a, const submitted_struct& b) {
+	if (a.segment != b.segment) {
+		return a.segment < b.segment;
+	}
+	if (a.layer != b.layer) {
+		return a.layer < b.layer;
+	}
+	if (!sortedLayer[a.layer]) {
+		return false;
+	}
+	if (a.texture != b.texture) {
+		return a.texture < b.texture;
+	}
+	return a.z < b.z;
+}
+
+static std::vector<submitted_struct> submitted;
+
+static void submit(GLuint texture, float z, int layer, int segmentIndex) {
+	sprite_struct sprite;
+	memset(&sprite, 0, sizeof(sprite));
+	sprite.texture = texture;
+	sprite.z = z;
+	sprite.tint = (unsigned int) submitted.size();
+	render_queue::submit(sprite, layer);
+
+	submitted_struct entry = {sprite.tint, layer, segmentIndex, texture, z};
+	submitted.push_back(entry);
+}
+
+/* Publishes what was submitted, executes it and compares the draw order with the reference. */
+static void executeAndCompare(int* slot) {
+	drawn.clear();
+	drawnSegment.clear();
+	segment = 0;
+
+	render_queue::publish(true);
+	render_queue::execute(*slot);
+	*slot = (*slot + 1) % render_thread::SLOT_COUNT;
+
+	std::vector<submitted_struct> expected = submitted;
+	std::stable_sort(expected.begin(), expected.end(), drawsBefore);
+
+	CHECK(drawn.size() == expected.size());
+	bool sameOrder = drawn.size() == expected.size();
+	for (size_t i = 0; sameOrder && i < drawn.size(); i++) {
+		sameOrder = drawn[i] == expected[i].id && drawnSegment[i] == expected[i].segment + 1;
+	}
+	CHECK(sameOrder);
+
+	submitted.clear();
+}
+
+static void setLayerSorted(int layer, bool sorted) {
+	render_queue::setLayerSorted(layer, sorted);
+	sortedLayer[layer] = sorted;
+}
+
+static void testSmallFrames(int* slot) {
+	setLayerSorted(1, false);
+	setLayerSorted(2, true);
+	render_queue::setMatrices(identity, identity);
+
+	// plain layers keep submission order whatever the textures and depths
+	submit(3, 5.0f, 1, 0);
+	submit(1, -2.0f, 1, 0);
+	submit(3, 0.0f, 1, 0);
+	executeAndCompare(slot);
+	CHECK(drawn[0] == 0 && drawn[1] == 1 && drawn[2] == 2);
+
+	// layers draw in ascending order even when submitted the other way round
+	submit(1, 0.0f, 2, 0);
+	submit(1, 0.0f, 1, 0);
+	executeAndCompare(slot);
+	CHECK(drawn[0] == 1 && drawn[1] == 0);
+
+	// a sorted layer groups by texture, back to front inside a texture, negative depths included
+	submit(2, 1.0f, 2, 0);
+	submit(1, 0.5f, 2, 0);
+	submit(2, -3.0f, 2, 0);
+	submit(1, -0.5f, 2, 0);
+	submit(1, 0.5f, 2, 0);
+	executeAndCompare(slot);
+	CHECK(drawn[0] == 3 && drawn[1] == 1 && drawn[2] == 4 && drawn[3] == 2 && drawn[4] == 0);
+
+	// a camera change splits the frame and nothing sorts across the split
+	submit(2, 0.0f, 2, 0);
+	float moved[16];
+	memcpy(moved, identity, sizeof(moved));
+	moved[12] = 10.0f;
+	render_queue::setMatrices(identity, moved);
+	submit(1, 0.0f, 2, 1);
+	render_queue::setMatrices(identity, identity);
+	executeAndCompare(slot);
+	CHECK(drawn[0] == 0 && drawn[1] == 1);
+}
+
+static void testLargeFrames(int* slot) {
+	srand(1);
+	for (int layer = 0; layer < 8; layer++) {
+		setLayerSorted(layer, (layer & 1) != 0);
+	}
+
+	for (int frame = 0; frame < 20; frame++) {
+		int segments = 1 + frame % 3;
+		for (int s = 0; s < segments; s++) {
+			float view[16];
+			memcpy(view, identity, sizeof(view));
+			view[12] = (float) (frame * 4 + s);
+			render_queue::setMatrices(identity, view);
+
+			for (int i = 0; i < 3000; i++) {
+				// quarter steps in a narrow range give plenty of equal keys to test stability
+				submit(1 + rand() % 12, (rand() % 200 - 100) * 0.25f, rand() % 8, s);
+			}
+		}
+		executeAndCompare(slot);
+	}
+
+	render_queue::setMatrices(identity, identity);
+	for (int frame = 0; frame < 10; frame++) {
+		for (int i = 0; i < 10000; i++) {
+			submit(1 + rand() % 64, (float) (rand() % 1000), 1, 0);
+		}
+		executeAndCompare(slot);
+	}
+	render_queue::endFrame();
+
+	int commands;
+	float sortMicros;
+	render_queue::getStats(&commands, &sortMicros);
+	printf("render_queue_test: %i commands sorted in %.0f us, %.0f us per 10k\n",
+		commands, sortMicros, sortMicros * 10000.0f / commands);
+}
+
+int main() {
+	int slot = 0;
+	testSmallFrames(&slot);
+	testLargeFrames(&slot);
+
+	if (failures != 0) {
+		printf("render_queue_test: %i checks failed\n", failures);
+		return 1;
+	}
+	printf("render_queue_test: passed\n");
+	return 0;
+}
@@ -0,0 +1,24 @@
+#!/bin/sh
+# Builds the host benchmarks into tools/build against the stub GL in tools/host and runs them
+cd "$(dirname "$0")/.."
+mkdir -p tools/build
+
+JNI=app/src/main/jni
+STATUS=0
+
+# stb_image lays out its unfilter loops in a way -Wall reads as misleading
+WARNINGS="-Wall -Wno-misleading-indentation"
+
+run() {
+	name=$1
+	shift
+	echo "== $name"
+	g++ -O2 $WARNINGS -Itools/host -I$JNI/include "$@" -o tools/build/$name -lpthread && tools/build/$name || STATUS=1
+}
+
+run sprite_batch_bench tools/sprite_batch_bench.cpp tools/host/stub_gl.cpp $JNI/sprite_batch.cpp $JNI/stream_buffer.cpp $JNI/gl_state.cpp
+run texture_restore_bench tools/texture_restore_bench.cpp tools/host/stub_gl.cpp tools/host/image_files.cpp $JNI/texture_atlas.cpp $JNI/rect_packer.cpp $JNI/pixel_convert.cpp $JNI/gl_state.cpp
+run png_decode_bench tools/png_decode_bench.cpp tools/host/stb_reference.cpp tools/host/png_corpus.cpp tools/host/image_files.cpp -lz
+run decode_batch_bench tools/decode_batch_bench.cpp tools/host/png_corpus.cpp tools/host/image_files.cpp $JNI/worker_pool.cpp $JNI/pixel_convert.cpp -lz
+
+exit $STATUS
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Builds the host tests into tools/build against the stub GL in tools/host and runs them
+cd "$(dirname "$0")/.."
+mkdir -p tools/build
+
+JNI=app/src/main/jni
+STATUS=0
+
+# stb_image lays out its unfilter loops in a way -Wall reads as misleading
+WARNINGS="-Wall -Wno-misleading-indentation"
+
+run() {
+	name=$1
+	shift
+	g++ -O2 $WARNINGS -Itools/host -I$JNI/include "$@" -o tools/build/$name -lpthread && tools/build/$name || STATUS=1
+}
+
+run gl_state_test tools/gl_state_test.cpp tools/host/stub_gl.cpp $JNI/gl_state.cpp
+run rect_packer_test tools/rect_packer_test.cpp $JNI/rect_packer.cpp
+run texture_atlas_test tools/texture_atlas_test.cpp tools/host/stub_gl.cpp $JNI/texture_atlas.cpp $JNI/rect_packer.cpp $JNI/gl_state.cpp $JNI/pixel_convert.cpp
+run render_queue_test tools/render_queue_test.cpp tools/host/stub_gl.cpp $JNI/render_queue.cpp $JNI/gl_state.cpp
+run damage_region_test tools/damage_region_test.cpp $JNI/damage_region.cpp
+run pixel_convert_test tools/pixel_convert_test.cpp $JNI/pixel_convert.cpp
+run frame_scheduler_test tools/frame_scheduler_test.cpp $JNI/frame_scheduler.cpp
+run asset_stream_test tools/asset_stream_test.cpp tools/host/host_assets.cpp tools/host/image_files.cpp $JNI/asset_stream.cpp
+run png_identity_check tools/png_identity_check.cpp tools/host/stb_reference.cpp tools/host/png_corpus.cpp tools/host/image_files.cpp -lz
+
+exit $STATUS
@@ -0,0 +1,99 @@
+/**
+ * Host benchmark for sprite_batch. Runs frames of 1k and 10k sprites
+ * through the engine's batcher, stream_buffer and gl_state on top of
+ * tools/host/stub_gl, once expanded the way ES2 draws and once instanced
+ * the way ES3 does, and prints draw calls, GL calls and CPU time per frame.
+ *
+ * The texture order is what drives batching: every sprite on one texture,
+ * eight textures in runs of equal length, and eight textures interleaved
+ * sprite by sprite, the worst case a scene without sorting produces.
+ *
+ * Usage: sprite_batch_bench
+ */
+#include <stdio.h>
+#include <time.h>
+
+#include <engine/sprite_batch.h>
+#include <engine/stream_buffer.h>
+#include <engine/gl_state.h>
+
+#include "host/stub_gl.h"
+
+static const int FRAMES = 200;
+
+enum texture_order {
+	ONE_TEXTURE,
+	RUNS,
+	INTERLEAVED
+};
+
+static const char* orderNames[] = {"one texture", "8 textures in runs", "8 textures interleaved"};
+
+static double nowMillis() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+static GLuint textureFor(int order, int index, int count) {
+	if (order == ONE_TEXTURE) {
+		return 1;
+	}
+	if (order == RUNS) {
+		return 1 + index * 8 / count;
+	}
+	return 1 + index % 8;
+}
+
+static void run(int count, int order, bool instanced) {
+	static const float identity[16] = {1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1};
+
+	stub_gl::reset();
+	gl_state::reset();
+	stream_buffer::init(instanced);
+	sprite_batch::init(1, instanced);
+	sprite_batch::setMatrices(identity, identity);
+
+	sprite_struct sprite = {0, {0.0f, 0.0f, 1.0f, 1.0f}, {-16.0f, -16.0f, 16.0f, 16.0f}, 0, 0, 0, 0, 1.0f, 0xffffffff};
+
+	double start = nowMillis();
+	int startCalls = stub_gl::totalCalls();
+	int drawCalls = 0;
+	float batchMillis = 0;
+	for (int frame = 0; frame < FRAMES; frame++) {
+		for (int i = 0; i < count; i++) {
+			sprite.texture = textureFor(order, i, count);
+			sprite.x = (float) (i % 100) * 10.0f;
+			sprite.y = (float) (i / 100) * 10.0f;
+			sprite.rotation = (i & 1) ? 0.0f : frame * 0.01f;
+			sprite_batch::add(sprite);
+		}
+		sprite_batch::endFrame();
+		stream_buffer::endFrame();
+		gl_state::endFrame();
+
+		int sprites;
+		float millis;
+		sprite_batch::getStats(&sprites, &drawCalls, &millis);
+		batchMillis += millis;
+	}
+	double elapsed = nowMillis() - start;
+
+	printf("%6i sprites, %-23s %-9s %5i draws, %6i GL calls, %.3f ms (batch stats %.3f ms) per frame\n",
+		count, orderNames[order], instanced ? "instanced" : "expanded", drawCalls,
+		(stub_gl::totalCalls() - startCalls) / FRAMES, elapsed / FRAMES, batchMillis / FRAMES);
+
+	sprite_batch::destroy();
+	stream_buffer::destroy();
+}
+
+int main() {
+	int counts[] = {1000, 10000};
+	for (int c = 0; c < 2; c++) {
+		for (int order = ONE_TEXTURE; order <= INTERLEAVED; order++) {
+			run(counts[c], order, false);
+			run(counts[c], order, true);
+		}
+	}
+	return 0;
+}
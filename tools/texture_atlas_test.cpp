@@ -0,0 +1,222 @@
+/**
+ * Host test for texture_atlas residency on top of tools/host/stub_gl. Pages
+ * of known size are adopted the way the upload thread hands them over, then
+ * frames are stepped with nextFrame and drawn with lookup. Checks that the
+ * least recently drawn page goes first once setBudget lowers the budget,
+ * that a page drawn this frame is never evicted even when that leaves the
+ * atlas over budget, that pinned pages survive, and that the textures of
+ * evicted and grown pages are only deleted by releaseRetired, once the
+ * frames that may still sample them are drawn. Also checks that pages are
+ * only grown on the GPU in formats the context can render to, and from
+ * their CPU copy otherwise.
+ *
+ * Usage: texture_atlas_test
+ */
+#include <stdio.h>
+#include <vector>
+
+#include <engine/texture_atlas.h>
+#include <engine/pixel_convert.h>
+#include <engine/gl_state.h>
+
+#include "host/stub_gl.h"
+
+static const long PAGE_BYTES = 400 * 1024;
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%i: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (0)
+
+static GLuint nextTexture = 1000;
+
+/* Adopts a 320x320 page of PAGE_BYTES with a single entry under label. */
+static int adopt(const char* label) {
+	static const float quad[4] = {-1.0f, -1.0f, 1.0f, 1.0f};
+	int page = texture_atlas::adoptPage(nextTexture++, PIXEL_RGBA8, PAGE_BYTES, 320, 320, 1);
+	texture_atlas::addEntry(label, page, 1, 1, 64, 64, quad);
+	return page;
+}
+
+static bool draw(const char* label) {
+	GLuint texture;
+	float uvRect[4], quadRect[4];
+	return texture_atlas::lookup(label, &texture, uvRect, quadRect);
+}
+
+static int residentKilobytes() {
+	int pageCount, kilobytes;
+	float fillRatio;
+	texture_atlas::getStats(&pageCount, &fillRatio, &kilobytes);
+	return kilobytes;
+}
+
+static int evictions() {
+	int entryCount, evictionCount, budget;
+	texture_atlas::getResidency(&entryCount, &evictionCount, &budget);
+	return evictionCount;
+}
+
+static void start() {
+	texture_atlas::destroy();
+	stub_gl::reset();
+	gl_state::reset();
+	texture_atlas::setBudget(64 * 1024);
+	texture_atlas::init(false);
+}
+
+static void testLeastRecentFirst() {
+	start();
+	int startEvictions = evictions();
+
+	// nothing was drawn yet, so going over budget on arrival evicts nothing
+	texture_atlas::setBudget(1024);
+	adopt("a");
+	adopt("b");
+	adopt("c");
+	CHECK(residentKilobytes() == 1200);
+	CHECK(evictions() == startEvictions);
+
+	texture_atlas::nextFrame();
+	draw("b");
+	draw("c");
+	texture_atlas::nextFrame();
+	draw("c");
+
+	texture_atlas::setBudget(1024);
+	CHECK(!draw("a"));
+	CHECK(draw("b") && draw("c"));
+	CHECK(residentKilobytes() == 800);
+	CHECK(evictions() == startEvictions + 1);
+}
+
+static void testDrawnThisFrame() {
+	start();
+	adopt("a");
+	adopt("b");
+	adopt("c");
+
+	texture_atlas::nextFrame();
+	draw("a");
+	draw("b");
+	texture_atlas::nextFrame();
+	draw("b");
+
+	// c and a can go, b was drawn this frame and stays even though that is still over budget
+	texture_atlas::setBudget(100);
+	CHECK(draw("b"));
+	CHECK(!draw("a") && !draw("c"));
+	CHECK(residentKilobytes() == 400);
+
+	// a page adopted while everything resident is in use is kept too
+	adopt("d");
+	CHECK(residentKilobytes() == 800);
+	CHECK(draw("b") && draw("d"));
+
+	// next frame nothing shields d any more
+	texture_atlas::nextFrame();
+	draw("b");
+	texture_atlas::setBudget(400);
+	CHECK(draw("b") && !draw("d"));
+	CHECK(residentKilobytes() <= 400);
+}
+
+static void testPinned() {
+	start();
+	int cooked = adopt("cooked");
+	texture_atlas::pinPage(cooked);
+	adopt("loose");
+
+	for (int i = 0; i < 3; i++) {
+		texture_atlas::nextFrame();
+	}
+	texture_atlas::setBudget(1);
+	CHECK(draw("cooked"));
+	CHECK(!draw("loose"));
+	CHECK(residentKilobytes() == 400);
+}
+
+static void testRetired() {
+	start();
+	adopt("a");
+	adopt("b");
+	texture_atlas::nextFrame();
+	draw("b");
+
+	// the frame on its way to the screen may still sample a
+	texture_atlas::setBudget(500);
+	CHECK(!draw("a"));
+	CHECK(stub_gl::calls("glDeleteTextures") == 0);
+	texture_atlas::releaseRetired();
+	CHECK(stub_gl::calls("glDeleteTextures") == 1);
+	texture_atlas::releaseRetired();
+	CHECK(stub_gl::calls("glDeleteTextures") == 1);
+
+	// a page that grows keeps its old texture until the next frame is drawn as well
+	texture_atlas::setBudget(64 * 1024);
+	std::vector<unsigned char> pixels(200 * 200 * 4, 0x80);
+	CHECK(texture_atlas::add("first", &pixels[0], 200, 200, PIXEL_RGBA8));
+	GLuint before, after;
+	float uvRect[4], quadRect[4];
+	CHECK(texture_atlas::lookup("first", &before, uvRect, quadRect));
+	CHECK(uvRect[2] * 256 == 201.0f);
+
+	CHECK(texture_atlas::add("second", &pixels[0], 200, 200, PIXEL_RGBA8));
+	CHECK(texture_atlas::lookup("first", &after, uvRect, quadRect));
+	CHECK(after != before);
+	CHECK(uvRect[2] * 512 == 201.0f);
+	CHECK(stub_gl::calls("glDeleteTextures") == 1);
+	texture_atlas::releaseRetired();
+	CHECK(stub_gl::calls("glDeleteTextures") == 2);
+}
+
+/* Adds two images that don't fit one 256 page together, so the page grows once, and returns whether that copy ran on the GPU. */
+static bool grownOnGpu(bool isES3, const char* extensions, GLenum status, int format) {
+	texture_atlas::destroy();
+	stub_gl::reset();
+	gl_state::reset();
+	stub_gl::setExtensions(extensions);
+	stub_gl::setFramebufferStatus(status);
+	texture_atlas::init(isES3);
+
+	std::vector<unsigned char> pixels(200 * 200 * pixel_convert::bytesPerPixel(format), 0x80);
+	CHECK(texture_atlas::add("first", &pixels[0], 200, 200, format));
+	CHECK(texture_atlas::add("second", &pixels[0], 200, 200, format));
+	CHECK(stub_gl::calls("glCopyTexSubImage2D") + stub_gl::calls("glTexSubImage2D") == 3);
+	return stub_gl::calls("glCopyTexSubImage2D") == 1;
+}
+
+static void testGrowPath() {
+	CHECK(grownOnGpu(true, "", GL_FRAMEBUFFER_COMPLETE, PIXEL_RGBA8));
+	CHECK(grownOnGpu(true, "", GL_FRAMEBUFFER_COMPLETE, PIXEL_RGB8));
+
+	// ES2 only renders to 8-bit RGB and RGBA with OES_rgb8_rgba8
+	CHECK(!grownOnGpu(false, "", GL_FRAMEBUFFER_COMPLETE, PIXEL_RGBA8));
+	CHECK(!grownOnGpu(false, "GL_OES_rgb8_rgba8_extra", GL_FRAMEBUFFER_COMPLETE, PIXEL_RGB8));
+	CHECK(grownOnGpu(false, "GL_OES_depth24 GL_OES_rgb8_rgba8", GL_FRAMEBUFFER_COMPLETE, PIXEL_RGB8));
+	CHECK(grownOnGpu(false, "", GL_FRAMEBUFFER_COMPLETE, PIXEL_RGB565));
+	CHECK(!grownOnGpu(true, "", GL_FRAMEBUFFER_COMPLETE, PIXEL_LA8));
+
+	// whatever the version says, a framebuffer the driver refuses means a CPU copy
+	CHECK(!grownOnGpu(true, "", GL_FRAMEBUFFER_UNSUPPORTED, PIXEL_RGBA4444));
+}
+
+int main() {
+	testLeastRecentFirst();
+	testDrawnThisFrame();
+	testPinned();
+	testRetired();
+	testGrowPath();
+
+	if (failures != 0) {
+		printf("texture_atlas_test: %i checks failed\n", failures);
+		return 1;
+	}
+	printf("texture_atlas_test: passed\n");
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+/**
+ * Host benchmark for restoring textures after the GL context is lost.
+ * Every image is restored both ways opengl_wrapper can do it: decoded again
+ * from its file (stb_image, premultiply, pixel_convert), and taken from the
+ * CPU cache of upload-ready pixels, which skips straight to the atlas. Both
+ * end in texture_atlas::add on top of tools/host/stub_gl, so the numbers are
+ * the CPU side of a restore; the driver copy comes on top on a device.
+ *
+ * Rotation keeps the context and restores nothing, so it doesn't appear
+ * here; resizeMillis in getRenderStats covers it on device.
+ *
+ * Usage: texture_restore_bench [image or folder]...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <engine/texture_atlas.h>
+#include <engine/pixel_convert.h>
+#include <engine/gl_state.h>
+
+#include "host/image_files.h"
+
+static const int RESTORES = 10;
+
+struct image_struct {
+	std::string path;
+	const char* formatHint;
+	std::vector<unsigned char> file;
+	std::vector<unsigned char> cached;
+	int width, height, format;
+};
+
+static double nowMillis() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+/* The steps decodeTexture takes for a file that is neither compressed nor cached. */
+static bool decode(const image_struct& image, std::vector<unsigned char>* pixels, int* width, int* height, int* format) {
+	int channels;
+	unsigned char* rgba = stbi_load_from_memory(&image.file[0], (int) image.file.size(), width, height, &channels, 4);
+	if (rgba == NULL) {
+		return false;
+	}
+
+	*format = pixel_convert::formatFromHint(image.formatHint, channels);
+	if (channels == 2 || channels == 4) {
+		pixel_convert::premultiply(rgba, *width, *height);
+	}
+	pixels->resize((long) *width * *height * pixel_convert::bytesPerPixel(*format));
+	pixel_convert::convert(rgba, *width, *height, *format, &(*pixels)[0]);
+	stbi_image_free(rgba);
+	return true;
+}
+
+/* A fresh context: the atlas starts empty, like after EGL_CONTEXT_LOST. */
+static void loseContext() {
+	texture_atlas::destroy();
+	gl_state::reset();
+	texture_atlas::init(true);
+}
+
+int main(int argc, char** argv) {
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		image_files::collect(argv[i], ".png", &paths);
+	}
+	if (argc == 1) {
+		image_files::collect("app/src/main/assets/images", ".png", &paths);
+	}
+
+	static const char* hints[] = {NULL, "rgb565"};
+	std::vector<image_struct> images;
+	for (size_t i = 0; i < paths.size(); i++) {
+		for (int hint = 0; hint < 2; hint++) {
+			image_struct image;
+			image.path = paths[i];
+			image.formatHint = hints[hint];
+			if (!image_files::read(paths[i], &image.file) || !decode(image, &image.cached, &image.width, &image.height, &image.format)) {
+				fprintf(stderr, "Skipping %s\n", paths[i].c_str());
+				break;
+			}
+			images.push_back(image);
+		}
+	}
+	if (images.empty()) {
+		fprintf(stderr, "Usage: %s [image or folder]...\n", argv[0]);
+		return 1;
+	}
+
+	gl_state::reset();
+	texture_atlas::init(true);
+
+	double totalDecode = 0, totalCache = 0;
+	for (size_t i = 0; i < images.size(); i++) {
+		const image_struct& image = images[i];
+
+		double decodeMillis = 0;
+		std::vector<unsigned char> pixels;
+		int width, height, format;
+		for (int restore = 0; restore < RESTORES; restore++) {
+			loseContext();
+			double start = nowMillis();
+			decode(image, &pixels, &width, &height, &format);
+			texture_atlas::add(image.path.c_str(), &pixels[0], width, height, format);
+			decodeMillis += nowMillis() - start;
+		}
+
+		double cacheMillis = 0;
+		for (int restore = 0; restore < RESTORES; restore++) {
+			loseContext();
+			double start = nowMillis();
+			texture_atlas::add(image.path.c_str(), &image.cached[0], image.width, image.height, image.format);
+			cacheMillis += nowMillis() - start;
+		}
+
+		printf("%-50s %4ix%-4i %-6s decode %7.3f ms, cache %7.3f ms, %5.1fx\n", image.path.c_str(), image.width, image.height,
+			pixel_convert::formatName(image.format), decodeMillis / RESTORES, cacheMillis / RESTORES, decodeMillis / cacheMillis);
+		totalDecode += decodeMillis / RESTORES;
+		totalCache += cacheMillis / RESTORES;
+	}
+
+	printf("all %i textures: decode %.3f ms, cache %.3f ms per restore\n", (int) images.size(), totalDecode, totalCache);
+	texture_atlas::destroy();
+	return 0;
+}